@@ -0,0 +1,398 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+// Acquisition throughput and latency benchmark, run against the
+// simulated camera so that no hardware is needed.
+//
+// usage: PointGreyBench [max_frame_rate] [duration] [nb_frames]
+//
+// One JSON object is printed per case on stdout.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+
+#include "HwFrameCallback.h"
+#include "PointGreyCamera.h"
+#include "PointGreyInterface.h"
+#include "PointGreyPixelFormat.h"
+#include "PointGreySimBackend.h"
+
+using namespace lima;
+using namespace lima::PointGrey;
+
+static const int SENSOR_WIDTH = 2448;
+static const int SENSOR_HEIGHT = 2048;
+static const int NB_BUFFERS = 64;
+// payload of a 1 Gb/s link, in bytes per second
+static const double GIGE_LINK_RATE = 125E6;
+
+/*******************************************************************
+ * \class FrameCounter
+ * \brief records the retrieve -> newFrameReady latency of each frame
+ *******************************************************************/
+class FrameCounter : public HwFrameCallback
+{
+public:
+    FrameCounter() { reset(0); }
+
+    void reset(int nb_expected)
+    {
+        AutoMutex lock(m_cond.mutex());
+        m_latencies.clear();
+        m_latencies.reserve(nb_expected > 0 ? nb_expected : 1 << 16);
+        m_first = m_last = Timestamp();
+    }
+
+    int count()
+    {
+        AutoMutex lock(m_cond.mutex());
+        return m_latencies.size();
+    }
+
+    bool waitFrames(int nb_frames, double timeout)
+    {
+        Timestamp end = Timestamp::now() + Timestamp(timeout);
+        AutoMutex lock(m_cond.mutex());
+        while (int(m_latencies.size()) < nb_frames)
+        {
+            double left = end - Timestamp::now();
+            if (left <= 0)
+                return false;
+            m_cond.wait(left);
+        }
+        return true;
+    }
+
+    std::vector<double> m_latencies;
+    Timestamp m_first;
+    Timestamp m_last;
+    Timestamp m_start;
+
+protected:
+    virtual bool newFrameReady(const HwFrameInfoType& frame_info)
+    {
+        Timestamp now = Timestamp::now();
+        AutoMutex lock(m_cond.mutex());
+        // frame_timestamp is the retrieve time relative to the start
+        m_latencies.push_back(now - m_start - frame_info.frame_timestamp);
+        if (!m_first.isSet())
+            m_first = now;
+        m_last = now;
+        m_cond.broadcast();
+        return true;
+    }
+
+private:
+    Cond m_cond;
+};
+
+struct BenchCase
+{
+    const char *name;
+    ImageType image_type;
+    int width;
+    int height;
+    bool continuous;
+    // the stream stays open between acquisitions
+    bool armed_idle;
+};
+
+static double _percentile(std::vector<double>& values, double p)
+{
+    if (values.empty())
+        return 0;
+    size_t n = size_t(p * (values.size() - 1) + 0.5);
+    std::nth_element(values.begin(), values.begin() + n, values.end());
+    return values[n];
+}
+
+static void _runCase(Camera& cam, Interface& hw, FrameCounter& counter,
+                     const BenchCase& bench, double duration, int nb_frames)
+{
+    HwBufferCtrlObj *buffer = cam.getBufferCtrlObj();
+
+    cam.setArmedIdle(bench.armed_idle);
+    cam.setImageType(bench.image_type);
+    Size sensor;
+    cam.getDetectorImageSize(sensor);
+    Roi roi(0, 0, bench.width, bench.height);
+    if (bench.width == sensor.getWidth() && bench.height == sensor.getHeight())
+        roi = Roi();
+    cam.setRoi(roi);
+
+    Roi hw_roi;
+    cam.getRoi(hw_roi);
+    FrameDim frame_dim(hw_roi.getSize(), bench.image_type);
+    buffer->setFrameDim(frame_dim);
+    buffer->setNbBuffers(NB_BUFFERS);
+
+    int expected = bench.continuous ? 0 : nb_frames;
+    cam.setNbFrames(expected);
+    counter.reset(expected);
+
+    hw.prepareAcq();
+
+    Timestamp t0 = Timestamp::now();
+    counter.m_start = t0;
+    hw.startAcq();
+    Timestamp t1 = Timestamp::now();
+
+    double stop_latency = 0;
+    if (bench.continuous)
+    {
+        counter.waitFrames(1, 10.);
+        usleep(long(duration * 1E6));
+        Timestamp t2 = Timestamp::now();
+        hw.stopAcq();
+        stop_latency = Timestamp::now() - t2;
+    }
+    else
+        counter.waitFrames(nb_frames, 10. + nb_frames);
+
+    // wait for the acquisition to be over
+    HwInterface::StatusType status;
+    do
+    {
+        usleep(1000);
+        hw.getStatus(status);
+    }
+    while (status.acq == AcqRunning);
+
+    std::vector<double> latencies = counter.m_latencies;
+    int frames = latencies.size();
+    double elapsed = counter.m_last - counter.m_first;
+    double fps = (frames > 1 && elapsed > 0) ? (frames - 1) / elapsed : 0;
+    double bandwidth = fps * frame_dim.getMemSize() / 1E6;
+    double first_frame = counter.m_first.isSet() ? double(counter.m_first - t1) : -1;
+
+    int high_water;
+    cam.getRingHighWater(high_water);
+
+    printf("{\"case\": \"%s\", \"width\": %d, \"height\": %d, \"nb_frames\": %d, "
+           "\"frames\": %d, \"fps\": %.2f, \"bandwidth_mb_s\": %.1f, "
+           "\"latency_us\": {\"min\": %.1f, \"p50\": %.1f, \"p99\": %.1f, \"max\": %.1f}, "
+           "\"start_acq_ms\": %.3f, \"first_frame_ms\": %.3f, \"stop_acq_ms\": %.3f, "
+           "\"ring_high_water\": %d}\n",
+           bench.name, hw_roi.getSize().getWidth(), hw_roi.getSize().getHeight(),
+           expected, frames, fps, bandwidth,
+           _percentile(latencies, 0.) * 1E6, _percentile(latencies, 0.5) * 1E6,
+           _percentile(latencies, 0.99) * 1E6, _percentile(latencies, 1.) * 1E6,
+           double(t1 - t0) * 1E3, first_frame * 1E3, stop_latency * 1E3,
+           high_water);
+    fflush(stdout);
+}
+
+// Start and stop over and over, the stop latency has to stay
+// bounded whether frames come in or not
+static void _runStartStop(Camera& cam, Interface& hw, const char *name,
+                          TrigMode trig_mode, int nb_loops)
+{
+    cam.setArmedIdle(false);
+    cam.setTrigMode(trig_mode);
+    cam.setNbFrames(0);
+
+    std::vector<double> latencies;
+    latencies.reserve(nb_loops);
+    Timestamp t0 = Timestamp::now();
+    for (int i = 0; i < nb_loops; ++i)
+    {
+        hw.prepareAcq();
+        hw.startAcq();
+        // from before the first frame to a few frames in
+        usleep((i % 10) * 1000);
+        hw.stopAcq();
+
+        double latency;
+        cam.getLastStopLatency(latency);
+        latencies.push_back(latency);
+    }
+    double elapsed = Timestamp::now() - t0;
+    cam.setTrigMode(IntTrig);
+
+    printf("{\"case\": \"%s\", \"loops\": %d, \"elapsed_s\": %.2f, "
+           "\"stop_ms\": {\"min\": %.3f, \"p50\": %.3f, \"p99\": %.3f, \"max\": %.3f}}\n",
+           name, nb_loops, elapsed,
+           _percentile(latencies, 0.) * 1E3, _percentile(latencies, 0.5) * 1E3,
+           _percentile(latencies, 0.99) * 1E3, _percentile(latencies, 1.) * 1E3);
+    fflush(stdout);
+}
+
+// Mono12 unpack alone, against what a GigE link can deliver
+static void _runUnpack(int nb_loops)
+{
+    size_t nb_pixels = size_t(SENSOR_WIDTH) * SENSOR_HEIGHT;
+    std::vector<unsigned char> packed(nb_pixels * 3 / 2);
+    std::vector<unsigned short> pixels(nb_pixels);
+    for (size_t i = 0; i < packed.size(); ++i)
+        packed[i] = (unsigned char) i;
+
+    unpackMono12(&packed[0], &pixels[0], nb_pixels);
+    Timestamp t0 = Timestamp::now();
+    for (int i = 0; i < nb_loops; ++i)
+        unpackMono12(&packed[0], &pixels[0], nb_pixels);
+    double elapsed = Timestamp::now() - t0;
+
+    double fps = nb_loops / elapsed;
+    double link_fps = GIGE_LINK_RATE / packed.size();
+    printf("{\"case\": \"unpack_mono12_full\", \"kernel\": \"%s\", \"width\": %d, "
+           "\"height\": %d, \"fps\": %.1f, \"mpixel_s\": %.1f, \"gige_link_fps\": %.1f}\n",
+           unpackMono12Kernel(), SENSOR_WIDTH, SENSOR_HEIGHT, fps,
+           fps * nb_pixels / 1E6, link_fps);
+    fflush(stdout);
+}
+
+// Y16 byte swap copy, against the plain copy it replaces
+static void _runSwap(int nb_loops)
+{
+    size_t nb_pixels = size_t(SENSOR_WIDTH) * SENSOR_HEIGHT;
+    std::vector<unsigned char> src(nb_pixels * 2, 1);
+    std::vector<unsigned char> dst(nb_pixels * 2);
+
+    memcpy(&dst[0], &src[0], dst.size());
+    Timestamp t0 = Timestamp::now();
+    for (int i = 0; i < nb_loops; ++i)
+        memcpy(&dst[0], &src[0], dst.size());
+    double copy_fps = nb_loops / (Timestamp::now() - t0);
+
+    swapBytes16(&src[0], &dst[0], nb_pixels);
+    t0 = Timestamp::now();
+    for (int i = 0; i < nb_loops; ++i)
+        swapBytes16(&src[0], &dst[0], nb_pixels);
+    double swap_fps = nb_loops / (Timestamp::now() - t0);
+
+    printf("{\"case\": \"swap16_full\", \"kernel\": \"%s\", \"width\": %d, "
+           "\"height\": %d, \"fps\": %.1f, \"memcpy_fps\": %.1f}\n",
+           swapBytes16Kernel(), SENSOR_WIDTH, SENSOR_HEIGHT, swap_fps, copy_fps);
+    fflush(stdout);
+}
+
+// 16 bit frames summed into 32 bit ones
+static void _runAccumulate(int nb_loops)
+{
+    size_t nb_pixels = size_t(SENSOR_WIDTH) * SENSOR_HEIGHT;
+    std::vector<unsigned short> src(nb_pixels);
+    std::vector<unsigned int> sum(nb_pixels);
+    for (size_t i = 0; i < src.size(); ++i)
+        src[i] = (unsigned short) i;
+
+    accumulate16(&src[0], &sum[0], nb_pixels, true, 0xffff);
+    Timestamp t0 = Timestamp::now();
+    for (int i = 0; i < nb_loops; ++i)
+        accumulate16(&src[0], &sum[0], nb_pixels, false, 0xffff);
+    double fps = nb_loops / (Timestamp::now() - t0);
+
+    printf("{\"case\": \"accumulate16_full\", \"kernel\": \"%s\", \"width\": %d, "
+           "\"height\": %d, \"fps\": %.1f}\n",
+           accumulateKernel(), SENSOR_WIDTH, SENSOR_HEIGHT, fps);
+    fflush(stdout);
+}
+
+// Bayer RAW8 to RGB24 and to luminance
+static void _runDemosaic(int nb_loops)
+{
+    size_t nb_pixels = size_t(SENSOR_WIDTH) * SENSOR_HEIGHT;
+    std::vector<unsigned char> raw(nb_pixels);
+    std::vector<unsigned char> rgb(nb_pixels * 3);
+    for (size_t i = 0; i < raw.size(); ++i)
+        raw[i] = (unsigned char) i;
+
+    Timestamp t0 = Timestamp::now();
+    for (int i = 0; i < nb_loops; ++i)
+        demosaicRGB24(&raw[0], &rgb[0], SENSOR_WIDTH, SENSOR_HEIGHT, SENSOR_WIDTH, BayerRGGB);
+    double rgb_fps = nb_loops / (Timestamp::now() - t0);
+
+    t0 = Timestamp::now();
+    for (int i = 0; i < nb_loops; ++i)
+        bayerLuminance8(&raw[0], &rgb[0], SENSOR_WIDTH, SENSOR_HEIGHT, SENSOR_WIDTH);
+    double luminance_fps = nb_loops / (Timestamp::now() - t0);
+
+    double link_fps = GIGE_LINK_RATE / raw.size();
+    printf("{\"case\": \"demosaic_raw8_full\", \"kernel\": \"%s\", \"width\": %d, "
+           "\"height\": %d, \"rgb_fps\": %.1f, \"luminance_fps\": %.1f, \"gige_link_fps\": %.1f}\n",
+           demosaicKernel(), SENSOR_WIDTH, SENSOR_HEIGHT, rgb_fps, luminance_fps, link_fps);
+    fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+    double max_frame_rate = (argc > 1) ? atof(argv[1]) : 200.;
+    double duration = (argc > 2) ? atof(argv[2]) : 2.;
+    int nb_frames = (argc > 3) ? atoi(argv[3]) : 100;
+
+    static const BenchCase cases[] = {
+        {"mono8_full_continuous",  Bpp8,  SENSOR_WIDTH, SENSOR_HEIGHT, true, false},
+        {"mono8_full_nframes",     Bpp8,  SENSOR_WIDTH, SENSOR_HEIGHT, false, false},
+        {"mono16_full_continuous", Bpp16, SENSOR_WIDTH, SENSOR_HEIGHT, true, false},
+        {"mono16_full_nframes",    Bpp16, SENSOR_WIDTH, SENSOR_HEIGHT, false, false},
+        {"mono12_full_continuous", Bpp12, SENSOR_WIDTH, SENSOR_HEIGHT, true, false},
+        {"mono12_full_nframes",    Bpp12, SENSOR_WIDTH, SENSOR_HEIGHT, false, false},
+        {"mono8_roi_continuous",   Bpp8,  256, 256, true, false},
+        {"mono8_roi_nframes",      Bpp8,  256, 256, false, false},
+        {"mono16_roi_continuous",  Bpp16, 256, 256, true, false},
+        {"mono16_roi_nframes",     Bpp16, 256, 256, false, false},
+        // the first one opens the stream, the second re-arms it
+        {"mono8_roi_nframes_arm",   Bpp8,  256, 256, false, true},
+        {"mono8_roi_nframes_rearm", Bpp8,  256, 256, false, true},
+    };
+    static const int nb_cases = sizeof(cases) / sizeof(cases[0]);
+
+    try
+    {
+        SimBackend *sim = new SimBackend(SENSOR_WIDTH, SENSOR_HEIGHT, max_frame_rate);
+        Camera cam(sim);
+        Interface hw(cam);
+        cam.setExpTime(0.01);
+        // the latencies are measured against host retrieve times
+        cam.setHwTimestamp(false);
+
+        double connect_time, init_time;
+        cam.getStartupTime(connect_time, init_time);
+        printf("{\"case\": \"startup\", \"init_ms\": %.3f}\n", init_time * 1E3);
+
+        FrameCounter counter;
+        cam.getBufferCtrlObj()->registerFrameCallback(counter);
+
+        for (int i = 0; i < nb_cases; ++i)
+            _runCase(cam, hw, counter, cases[i], duration, nb_frames);
+
+        // no trigger ever comes in ExtTrigMult
+        _runStartStop(cam, hw, "start_stop_inttrig", IntTrig, 2000);
+        _runStartStop(cam, hw, "start_stop_exttrig", ExtTrigMult, 2000);
+
+        cam.getBufferCtrlObj()->unregisterFrameCallback(counter);
+
+        _runUnpack(200);
+        _runSwap(200);
+        _runAccumulate(200);
+        _runDemosaic(50);
+    }
+    catch (Exception& e)
+    {
+        fprintf(stderr, "benchmark failed: %s\n", e.getErrDesc().c_str());
+        return 1;
+    }
+    return 0;
+}
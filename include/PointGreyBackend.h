@@ -0,0 +1,239 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+#ifndef POINTGREYBACKEND_H
+#define POINTGREYBACKEND_H
+
+#include <string>
+
+#include "FlyCapture2.h"
+
+#ifdef USE_GIGE
+typedef FlyCapture2::GigECamera Camera_t;
+typedef FlyCapture2::GigEImageSettings ImageSettings_t;
+typedef FlyCapture2::GigEImageSettingsInfo ImageSettingsInfo_t;
+#else
+typedef FlyCapture2::Camera Camera_t;
+typedef FlyCapture2::Format7ImageSettings ImageSettings_t;
+typedef FlyCapture2::Format7Info ImageSettingsInfo_t;
+#endif
+
+namespace lima
+{
+namespace PointGrey
+{
+/*******************************************************************
+ * \class BackendError
+ * \brief FlyCapture2 error status that a backend can also build
+ *
+ * FlyCapture2::Error can only be produced by the driver, this one
+ * carries the same type and description and can be created by a
+ * simulated backend.
+ *******************************************************************/
+class BackendError
+{
+public:
+    BackendError()
+        : m_type(FlyCapture2::PGRERROR_OK) {}
+    BackendError(const FlyCapture2::Error& error)
+        : m_type(error.GetType())
+    {
+        if (m_type != FlyCapture2::PGRERROR_OK)
+            m_description = error.GetDescription();
+    }
+    BackendError(FlyCapture2::ErrorType type, const std::string& description)
+        : m_type(type), m_description(description) {}
+
+    bool operator==(FlyCapture2::ErrorType type) const { return m_type == type; }
+    bool operator!=(FlyCapture2::ErrorType type) const { return m_type != type; }
+
+    FlyCapture2::ErrorType GetType() const { return m_type; }
+    const char *GetDescription() const { return m_description.c_str(); }
+
+private:
+    FlyCapture2::ErrorType m_type;
+    std::string m_description;
+};
+
+/*******************************************************************
+ * \class Backend
+ * \brief camera access used by Camera, mirroring the FlyCapture2 API
+ *******************************************************************/
+class Backend
+{
+public:
+    virtual ~Backend() {}
+
+    virtual BackendError Disconnect() = 0;
+    virtual BackendError GetCameraInfo(FlyCapture2::CameraInfo* pCameraInfo) = 0;
+
+    virtual BackendError GetConfiguration(FlyCapture2::FC2Config* pConfig) = 0;
+    virtual BackendError SetConfiguration(const FlyCapture2::FC2Config* pConfig) = 0;
+
+    virtual BackendError StartCapture() = 0;
+    virtual BackendError StopCapture() = 0;
+    virtual BackendError RetrieveBuffer(FlyCapture2::Image* pImage) = 0;
+
+    virtual BackendError GetPropertyInfo(FlyCapture2::PropertyInfo* pPropInfo) = 0;
+    virtual BackendError GetProperty(FlyCapture2::Property* pProp) = 0;
+    virtual BackendError SetProperty(const FlyCapture2::Property* pProp) = 0;
+
+    virtual BackendError GetTriggerModeInfo(FlyCapture2::TriggerModeInfo* pTriggerModeInfo) = 0;
+    virtual BackendError GetTriggerMode(FlyCapture2::TriggerMode* pTriggerMode) = 0;
+    virtual BackendError SetTriggerMode(const FlyCapture2::TriggerMode* pTriggerMode) = 0;
+    virtual BackendError FireSoftwareTrigger() = 0;
+
+    virtual BackendError ReadRegister(unsigned int address, unsigned int* pValue) = 0;
+    virtual BackendError WriteRegister(unsigned int address, unsigned int value) = 0;
+
+    virtual BackendError GetStats(FlyCapture2::CameraStats* pStats) = 0;
+
+    virtual BackendError GetEmbeddedImageInfo(FlyCapture2::EmbeddedImageInfo* pInfo) = 0;
+    virtual BackendError SetEmbeddedImageInfo(FlyCapture2::EmbeddedImageInfo* pInfo) = 0;
+    // timestamp and embedded data of the last retrieved image
+    virtual BackendError GetImageMetadata(const FlyCapture2::Image* pImage,
+                                          FlyCapture2::TimeStamp* pTimeStamp,
+                                          FlyCapture2::ImageMetadata* pMetadata) = 0;
+
+#ifdef USE_GIGE
+    virtual BackendError GetGigEImageSettingsInfo(ImageSettingsInfo_t* pInfo) = 0;
+    virtual BackendError GetGigEImageSettings(ImageSettings_t* pSettings) = 0;
+    virtual BackendError SetGigEImageSettings(const ImageSettings_t* pSettings) = 0;
+    virtual BackendError GetGigEImageBinningSettings(unsigned int* pHorzBinnningValue,
+                                                     unsigned int* pVertBinnningValue) = 0;
+    virtual BackendError SetGigEImageBinningSettings(unsigned int horzBinnningValue,
+                                                     unsigned int vertBinnningValue) = 0;
+    virtual BackendError DiscoverGigEPacketSize(unsigned int* pPacketSize) = 0;
+    virtual BackendError GetGigEProperty(FlyCapture2::GigEProperty* pGigEProp) = 0;
+    virtual BackendError SetGigEProperty(const FlyCapture2::GigEProperty* pGigEProp) = 0;
+#else
+    virtual BackendError GetFormat7Info(ImageSettingsInfo_t* pInfo, bool* pSupported) = 0;
+    virtual BackendError ValidateFormat7Settings(const ImageSettings_t* pSettings,
+                                                 bool* pSettingsAreValid,
+                                                 FlyCapture2::Format7PacketInfo* pPacketInfo) = 0;
+    virtual BackendError GetFormat7Configuration(ImageSettings_t* pSettings,
+                                                 unsigned int* pPacketSize,
+                                                 float* pPercentage) = 0;
+    virtual BackendError SetFormat7Configuration(const ImageSettings_t* pSettings,
+                                                 unsigned int packetSize) = 0;
+#endif
+};
+
+/*******************************************************************
+ * \class BackendGuard
+ * \brief deletes a backend until its ownership is released
+ *
+ * Holds a new backend while the camera taking it over is built, so
+ * that it is not leaked when the construction throws.
+ *******************************************************************/
+class BackendGuard
+{
+public:
+    explicit BackendGuard(Backend *backend)
+        : m_backend(backend) {}
+    ~BackendGuard() { delete m_backend; }
+
+    Backend *release()
+    {
+        Backend *backend = m_backend;
+        m_backend = NULL;
+        return backend;
+    }
+
+private:
+    BackendGuard(const BackendGuard&);
+    BackendGuard& operator=(const BackendGuard&);
+
+    Backend *m_backend;
+};
+
+/*******************************************************************
+ * \class FlyCapBackend
+ * \brief backend driving a real camera through FlyCapture2
+ *******************************************************************/
+class FlyCapBackend : public Backend
+{
+public:
+    FlyCapBackend() {}
+    virtual ~FlyCapBackend() {}
+
+    BackendError Connect(FlyCapture2::PGRGuid* pGuid);
+
+    virtual BackendError Disconnect();
+    virtual BackendError GetCameraInfo(FlyCapture2::CameraInfo* pCameraInfo);
+
+    virtual BackendError GetConfiguration(FlyCapture2::FC2Config* pConfig);
+    virtual BackendError SetConfiguration(const FlyCapture2::FC2Config* pConfig);
+
+    virtual BackendError StartCapture();
+    virtual BackendError StopCapture();
+    virtual BackendError RetrieveBuffer(FlyCapture2::Image* pImage);
+
+    virtual BackendError GetPropertyInfo(FlyCapture2::PropertyInfo* pPropInfo);
+    virtual BackendError GetProperty(FlyCapture2::Property* pProp);
+    virtual BackendError SetProperty(const FlyCapture2::Property* pProp);
+
+    virtual BackendError GetTriggerModeInfo(FlyCapture2::TriggerModeInfo* pTriggerModeInfo);
+    virtual BackendError GetTriggerMode(FlyCapture2::TriggerMode* pTriggerMode);
+    virtual BackendError SetTriggerMode(const FlyCapture2::TriggerMode* pTriggerMode);
+    virtual BackendError FireSoftwareTrigger();
+
+    virtual BackendError ReadRegister(unsigned int address, unsigned int* pValue);
+    virtual BackendError WriteRegister(unsigned int address, unsigned int value);
+
+    virtual BackendError GetStats(FlyCapture2::CameraStats* pStats);
+
+    virtual BackendError GetEmbeddedImageInfo(FlyCapture2::EmbeddedImageInfo* pInfo);
+    virtual BackendError SetEmbeddedImageInfo(FlyCapture2::EmbeddedImageInfo* pInfo);
+    virtual BackendError GetImageMetadata(const FlyCapture2::Image* pImage,
+                                          FlyCapture2::TimeStamp* pTimeStamp,
+                                          FlyCapture2::ImageMetadata* pMetadata);
+
+#ifdef USE_GIGE
+    virtual BackendError GetGigEImageSettingsInfo(ImageSettingsInfo_t* pInfo);
+    virtual BackendError GetGigEImageSettings(ImageSettings_t* pSettings);
+    virtual BackendError SetGigEImageSettings(const ImageSettings_t* pSettings);
+    virtual BackendError GetGigEImageBinningSettings(unsigned int* pHorzBinnningValue,
+                                                     unsigned int* pVertBinnningValue);
+    virtual BackendError SetGigEImageBinningSettings(unsigned int horzBinnningValue,
+                                                     unsigned int vertBinnningValue);
+    virtual BackendError DiscoverGigEPacketSize(unsigned int* pPacketSize);
+    virtual BackendError GetGigEProperty(FlyCapture2::GigEProperty* pGigEProp);
+    virtual BackendError SetGigEProperty(const FlyCapture2::GigEProperty* pGigEProp);
+#else
+    virtual BackendError GetFormat7Info(ImageSettingsInfo_t* pInfo, bool* pSupported);
+    virtual BackendError ValidateFormat7Settings(const ImageSettings_t* pSettings,
+                                                 bool* pSettingsAreValid,
+                                                 FlyCapture2::Format7PacketInfo* pPacketInfo);
+    virtual BackendError GetFormat7Configuration(ImageSettings_t* pSettings,
+                                                 unsigned int* pPacketSize,
+                                                 float* pPercentage);
+    virtual BackendError SetFormat7Configuration(const ImageSettings_t* pSettings,
+                                                 unsigned int packetSize);
+#endif
+
+private:
+    Camera_t m_camera;
+};
+} // namespace PointGrey
+} // namespace lima
+
+#endif // POINTGREYBACKEND_H
@@ -24,22 +24,15 @@
 
 #include <stdlib.h>
 #include <limits>
+#include <vector>
+#include <map>
 #include "HwBufferMgr.h"
 #include "HwMaxImageSizeCallback.h"
 
-#include "FlyCapture2.h"
+#include "PointGreyBackend.h"
+#include "PointGreyLatency.h"
 using namespace std;
 
-#ifdef USE_GIGE
-typedef FlyCapture2::GigECamera Camera_t;
-typedef FlyCapture2::GigEImageSettings ImageSettings_t;
-typedef FlyCapture2::GigEImageSettingsInfo ImageSettingsInfo_t;
-#else
-typedef FlyCapture2::Camera Camera_t;
-typedef FlyCapture2::Format7ImageSettings ImageSettings_t;
-typedef FlyCapture2::Format7Info ImageSettingsInfo_t;
-#endif
-
 namespace lima
 {
 namespace PointGrey
@@ -53,16 +46,80 @@ class Camera : public HwMaxImageSizeCallbackGen
     DEB_CLASS_NAMESPC(DebModCamera, "Camera", "PointGrey");
 
     friend class Interface;
+    friend class Manager;
 public:
     enum Status {
         Ready, Exposure, Readout, Latency, Fault
     };
 
+    // what to do when frames are lost
+    enum DropPolicy {
+        DropFault, DropSkip, DropPlaceholder
+    };
+
+    // Bayer mosaic handling for the Bpp8 and Bpp16 image types
+    enum BayerMode {
+        BayerOff, BayerRaw, BayerLuminance
+    };
+
+    // driver buffering when retrieval lags behind: keep the
+    // newest frames or the oldest ones
+    enum GrabMode {
+        GrabDriverDefault, GrabDropFrames, GrabBufferFrames
+    };
+
+    // scheduling policy of the acquisition thread
+    enum SchedPolicy {
+        SchedOther, SchedFifo, SchedRR
+    };
+
+    // timed steps of the frame path
+    enum LatencyStage {
+        RetrieveStage, CopyStage, NewFrameReadyStage, StatusStage, TriggerStage,
+        NbLatencyStages
+    };
+
+    // packet_size 0 discovers the largest one the path carries,
+    // nb_buffers -1 and grab_timeout TIMEOUT_UNSPECIFIED keep the
+    // driver settings, acq_priority -1 is the highest priority of
+    // acq_policy
     Camera(const int camera_serial,
             const int packet_size = -1,
-            const int packet_delay = -1);
+            const int packet_delay = -1,
+            const int nb_buffers = -1,
+            const GrabMode grab_mode = GrabDriverDefault,
+            const int grab_timeout = FlyCapture2::TIMEOUT_UNSPECIFIED,
+            const bool high_perf_retrieve = false,
+            const std::string& acq_cpus = "",
+            const SchedPolicy acq_policy = SchedFifo,
+            const int acq_priority = -1);
+    // takes ownership of an already connected backend once
+    // built, the caller keeps it if the constructor throws
+    Camera(Backend *backend,
+            const int packet_size = -1,
+            const int packet_delay = -1,
+            const int nb_buffers = -1,
+            const GrabMode grab_mode = GrabDriverDefault,
+            const int grab_timeout = FlyCapture2::TIMEOUT_UNSPECIFIED,
+            const bool high_perf_retrieve = false,
+            const std::string& acq_cpus = "",
+            const SchedPolicy acq_policy = SchedFifo,
+            const int acq_priority = -1);
     ~Camera();
 
+    // connect by IP address ("a.b.c.d") or GUID, as given by
+    // getCameraGuid, without enumerating the bus first
+    static Camera *open(const std::string& camera_address,
+            const int packet_size = -1,
+            const int packet_delay = -1,
+            const int nb_buffers = -1,
+            const GrabMode grab_mode = GrabDriverDefault,
+            const int grab_timeout = FlyCapture2::TIMEOUT_UNSPECIFIED,
+            const bool high_perf_retrieve = false,
+            const std::string& acq_cpus = "",
+            const SchedPolicy acq_policy = SchedFifo,
+            const int acq_priority = -1);
+
     // hw interface
     void prepareAcq();
     void startAcq();
@@ -82,6 +139,7 @@ public:
     void setImageType(ImageType type);
 
     // synch control object
+    void checkTrigMode(TrigMode mode, bool& valid);
     void getTrigMode(TrigMode& mode);
     void setTrigMode(TrigMode mode);
 
@@ -104,12 +162,40 @@ public:
     void setBin(const Bin& bin);
 
     // camera specific
+    void getCameraGuid(std::string& guid);
+    // seconds spent finding and connecting the camera, then setting it up
+    void getStartupTime(double& connect_time, double& init_time);
+
     void getPacketSize(int& packet_size);
     void setPacketSize(int packet_size);
 
     void getPacketDelay(int& packet_delay);
     void setPacketDelay(int packet_delay);
 
+    // largest GigE packet size on the path, then applied
+    void discoverPacketSize(int& packet_size);
+    // packet delay following the resends and drops while acquiring
+    void getAutoPacketDelay(bool& auto_packet_delay);
+    void setAutoPacketDelay(bool auto_packet_delay);
+    // MB/s the auto packet delay keeps the camera under, 0 for none
+    void getBandwidthBudget(double& budget);
+    void setBandwidthBudget(double budget);
+
+    // driver stream configuration, applied at startAcq
+    void getNbBuffers(int& nb_buffers);
+    void setNbBuffers(int nb_buffers);
+    void getGrabMode(GrabMode& grab_mode);
+    void setGrabMode(GrabMode grab_mode);
+    // ms, -1 waits for ever
+    void getGrabTimeout(int& grab_timeout);
+    void setGrabTimeout(int grab_timeout);
+    void getHighPerfRetrieve(bool& high_perf_retrieve);
+    void setHighPerfRetrieve(bool high_perf_retrieve);
+    // keep the stream open after the last frame, the next
+    // startAcq then only opens the frame gate
+    void getArmedIdle(bool& armed_idle);
+    void setArmedIdle(bool armed_idle);
+
     void getGain(double& gain);
     void setGain(double gain);
     void getGainRange(double& min_gain, double& max_gain);
@@ -126,6 +212,82 @@ public:
 
     void getAutoFrameRate(bool& auto_frame_rate);
     void setAutoFrameRate(bool auto_frame_rate);
+
+    // drop the cached property values and ranges
+    void refreshProperties();
+
+    void getDirectRetrieve(bool& direct_retrieve);
+    void setDirectRetrieve(bool direct_retrieve);
+
+    // retrieve -> dispatch frame ring
+    void getRingSize(int& ring_size);
+    void setRingSize(int ring_size);
+    void getRingOccupancy(int& occupancy);
+    void getRingHighWater(int& high_water);
+
+    // camera embedded timestamp and frame counter
+    void getHwTimestamp(bool& hw_timestamp);
+    void setHwTimestamp(bool hw_timestamp);
+    void getLastFrameCounter(int& frame_counter);
+
+    // lost frame accounting, reset at prepareAcq
+    void getDropPolicy(DropPolicy& policy);
+    void setDropPolicy(DropPolicy policy);
+    void getDroppedFrames(int& dropped_frames);
+    void getInconsistentFrames(int& inconsistent_frames);
+    void getResentPackets(int& resent_packets);
+
+    // driver statistics over the running or last acquisition,
+    // polled once a second while acquiring
+    void getStreamStats(int& images_dropped, int& images_driver_dropped,
+                        int& images_corrupt, int& transmit_failures,
+                        int& resend_requested, int& resend_received);
+    // Celsius, from the last poll
+    void getTemperature(double& temperature);
+
+    // Mono16 byte order fixed on the host instead of the camera
+    void getY16ByteSwap(bool& y16_swap);
+    void setY16ByteSwap(bool y16_swap);
+
+    // cpus of the acquisition thread, Linux cpu list format
+    void getAcqCpus(std::string& cpus);
+    void setAcqCpus(const std::string& cpus);
+    void getAcqSchedPolicy(SchedPolicy& policy);
+    void setAcqSchedPolicy(SchedPolicy policy);
+    void getAcqSchedPriority(int& priority);
+    void setAcqSchedPriority(int priority);
+    // what the thread actually runs with
+    void getAppliedAcqCpus(std::string& cpus);
+    void getAppliedAcqSched(SchedPolicy& policy, int& priority);
+    // received data rate, MB/s
+    void getAcqBandwidth(double& bandwidth);
+
+    // colour cameras
+    void getBayerMode(BayerMode& mode);
+    void setBayerMode(BayerMode mode);
+
+    // sum nb_frames camera frames into each Lima frame, which is
+    // then Bpp32; 1 turns it off
+    void getAccNbFrames(int& nb_frames);
+    void setAccNbFrames(int nb_frames);
+    // saturated pixels summed into the last Lima frame, and the
+    // Lima frames with some since prepareAcq
+    void getAccSaturation(int& last_saturated, int& saturated_frames);
+
+    // frame path timing, in seconds, reset at prepareAcq
+    void getLatencyStats(bool& enabled);
+    void setLatencyStats(bool enabled);
+    void resetLatencyStats();
+    void getLatencySummary(LatencyStage stage, int& count, double& min_time,
+                           double& p50_time, double& p99_time, double& max_time);
+    // IntTrigMult, from the software trigger to the frame retrieved
+    void getLastTriggerLatency(double& latency);
+    // how long the last stopAcq took
+    void getLastStopLatency(double& latency);
+
+    // stage settings and write them in one batch at prepareAcq
+    void getDeferredConfig(bool& deferred);
+    void setDeferredConfig(bool deferred);
 protected:
     // property management
     void _getPropertyValue(FlyCapture2::PropertyType type, double& value);
@@ -133,35 +295,188 @@ protected:
     void _getPropertyRange(FlyCapture2::PropertyType type, double& min_value, double& max_value);
     void _getPropertyAutoMode(FlyCapture2::PropertyType type, bool& auto_mode);
     void _setPropertyAutoMode(FlyCapture2::PropertyType type, bool auto_mode);
+    void _getProperty(FlyCapture2::PropertyType type, FlyCapture2::Property& property);
+    void _setProperty(const FlyCapture2::Property& property);
+    void _getPropertyInfo(FlyCapture2::PropertyType type, FlyCapture2::PropertyInfo& property_info);
 
     void _getImageSettingsInfo();
+    bool _isImageSettingsApplied();
     void _applyImageSettings();
+    void _getTriggerModeInfo();
+    void _applyTrigMode(TrigMode mode);
+
+    // deferred configuration
+    void _commitConfig();
+    void _commitPropertyValue(FlyCapture2::PropertyType type, double value);
+    void _commitPropertyAutoMode(FlyCapture2::PropertyType type, bool auto_mode);
+
+    // binning management
+    void _getBinList();
+    void _applyBin(int bin_index);
 private:
     class _AcqThread;
     friend class _AcqThread;
+    class _DispatchThread;
+    friend class _DispatchThread;
+    class _FrameRing;
+    class _StatsThread;
+    friend class _StatsThread;
+
+    struct _StagedConfig
+    {
+        _StagedConfig()
+            : has_image_settings(false)
+            , has_trig_mode(false)
+            , has_exp_time(false)
+            , has_frame_rate(false)
+            , has_auto_frame_rate(false)
+            , has_gain(false)
+        {}
+
+        bool has_image_settings;
+        bool has_trig_mode;
+        TrigMode trig_mode;
+        bool has_exp_time;
+        double exp_time;
+        bool has_frame_rate;
+        double frame_rate;
+        bool has_auto_frame_rate;
+        bool auto_frame_rate;
+        bool has_gain;
+        double gain;
+    };
 
+    static std::string _formatGuid(const FlyCapture2::PGRGuid& guid);
+    void _initMembers(const std::string& acq_cpus, SchedPolicy acq_policy, int acq_priority);
+    void _init(int packet_size, int packet_delay, int nb_buffers,
+               GrabMode grab_mode, int grab_timeout, bool high_perf_retrieve);
+    void _applyStreamConfig();
+    void _tunePacketDelay(double now);
+    void _closeIdleStream();
+    void _pollStats();
+    void _fireSoftwareTrigger();
     void _setStatus(Camera::Status status, bool force);
     void _stopAcq(bool internalFlag);
     void _forcePGRY16Mode();
+    bool _isDirectFormat();
+    void _getCameraImageType(ImageType& type);
+    void _setEmbeddedImageInfo(bool enable);
+    double _hwTimestamp(const FlyCapture2::TimeStamp& timestamp, double host_time, bool first);
 
     SoftBufferCtrlObj m_buffer_ctrl_obj;
 
     Camera::Status m_status;
     int m_nb_frames;
     int m_image_number;
+    // first frame not yet handed to Lima by the dispatch thread
+    volatile int m_dispatched_frames;
+    Timestamp m_start_timestamp;
 
     _AcqThread *m_acq_thread;
+    _DispatchThread *m_dispatch_thread;
+    _StatsThread *m_stats_thread;
+    _FrameRing *m_ring;
+    int m_ring_size;
     Cond m_cond;
     volatile bool m_quit;
     volatile bool m_acq_started;
+    // capture started, still open between acquisitions when armed idle
+    volatile bool m_stream_open;
     volatile bool m_thread_running;
+    // the acquisition thread is in its retrieve loop
+    volatile bool m_retrieving;
+    volatile bool m_dispatch_continue;
+    // the dispatch thread is asked to leave the ring, and has left it
+    volatile bool m_dispatch_park;
+    volatile bool m_dispatch_idle;
+    bool m_direct_retrieve;
+    FlyCapture2::FC2Config m_stream_config;
+    bool m_stream_config_changed;
+    bool m_armed_idle;
+    bool m_deferred_config;
+    bool m_hw_timestamp;
+    bool m_hw_frame_counter;
+    volatile unsigned int m_last_frame_counter;
 
-    Camera_t *m_camera;
+    std::string m_acq_cpus;
+    SchedPolicy m_acq_policy;
+    int m_acq_priority;
+    volatile bool m_acq_sched_changed;
+    std::string m_applied_acq_cpus;
+    SchedPolicy m_applied_acq_policy;
+    int m_applied_acq_priority;
+    volatile double m_acq_bytes;
+    bool m_auto_packet_delay;
+    volatile double m_bandwidth_budget;
+    // packet delay tuning, acquisition thread only
+    double m_tune_time;
+    double m_tune_bytes;
+    unsigned int m_tune_resends;
+    unsigned int m_tune_dropped;
+    int m_tune_clean;
+    Timestamp m_last_frame_time;
+
+    bool m_y16_swap;
+    bool m_y16_native_valid;
+    unsigned int m_y16_native;
+
+    BayerMode m_bayer_mode;
+    bool m_bayer_rgb;
+
+    int m_acc_nb_frames;
+    volatile int m_acc_last_saturated;
+    volatile int m_acc_saturated_frames;
+
+    volatile bool m_latency_stats;
+    LatencyHistogram m_latency[NbLatencyStages];
+
+    DropPolicy m_drop_policy;
+    volatile int m_dropped_frames;
+    volatile int m_inconsistent_frames;
+    FlyCapture2::CameraStats m_start_stats;
+    bool m_start_stats_valid;
+    Mutex m_stats_lock;
+    FlyCapture2::CameraStats m_polled_stats;
+    bool m_polled_stats_valid;
+
+    // camera clock, unwrapped and anchored on the first frame
+    double m_hw_clock_origin;
+    double m_hw_clock_elapsed;
+    double m_hw_clock_last_cycle;
+    double m_hw_clock_last_host;
+    _StagedConfig m_staged;
+    int m_applied_trig_mode;
+    FlyCapture2::TriggerModeInfo m_trigger_mode_info;
+    bool m_trigger_mode_info_valid;
+    // last software trigger, on the latency clock
+    volatile double m_trigger_time;
+    volatile double m_trigger_latency;
+    volatile double m_stop_latency;
+
+    Backend *m_camera;
     FlyCapture2::CameraInfo m_camera_info;
-    FlyCapture2::Error m_error;
+    BackendError m_error;
+
+    typedef std::map<FlyCapture2::PropertyType, FlyCapture2::Property> PropertyCache;
+    typedef std::map<FlyCapture2::PropertyType, FlyCapture2::PropertyInfo> PropertyInfoCache;
+    PropertyCache m_property_cache;
+    PropertyInfoCache m_property_info_cache;
+
+    std::string m_guid;
+    double m_connect_time;
+    double m_init_time;
 
+    // image settings info per binning, it does not change otherwise
+    typedef std::map<std::pair<int, int>, ImageSettingsInfo_t> ImageSettingsInfoCache;
+    ImageSettingsInfoCache m_image_settings_info_cache;
     ImageSettingsInfo_t m_image_settings_info;
     ImageSettings_t m_image_settings;
+
+    Bin m_bin;
+    std::vector<Bin> m_bin_list;
+#ifndef USE_GIGE
+    std::vector<FlyCapture2::Mode> m_bin_modes;
+#endif
 };
 } // namespace PointGrey
 } // namespace lima
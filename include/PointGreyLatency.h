@@ -0,0 +1,65 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+#ifndef POINTGREYLATENCY_H
+#define POINTGREYLATENCY_H
+
+namespace lima
+{
+namespace PointGrey
+{
+/*******************************************************************
+ * \class LatencyHistogram
+ * \brief log scale histogram of durations, in seconds
+ *
+ * Filled by a single thread without locking. Readers may see a
+ * sample half recorded, which is fine for statistics; reset only
+ * when the writer is idle.
+ *******************************************************************/
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void record(double duration);
+    void reset();
+
+    void getSummary(int& count, double& min_value, double& p50,
+                    double& p99, double& max_value) const;
+
+    // monotonic clock, in seconds
+    static double now();
+
+private:
+    // 8 bins per octave from 100 ns up to about 7 minutes
+    enum { OCTAVE_BINS = 8, NB_OCTAVES = 32, NB_BINS = 1 + OCTAVE_BINS * NB_OCTAVES };
+
+    double _percentile(double fraction) const;
+
+    volatile unsigned int m_bins[NB_BINS];
+    volatile unsigned int m_count;
+    volatile double m_min;
+    volatile double m_max;
+};
+} // namespace PointGrey
+} // namespace lima
+
+#endif // POINTGREYLATENCY_H
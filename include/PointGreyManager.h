@@ -0,0 +1,99 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+#ifndef POINTGREYMANAGER_H
+#define POINTGREYMANAGER_H
+
+#include <string>
+#include <vector>
+
+#include "Debug.h"
+#include "FlyCapture2.h"
+#include "PointGreyCamera.h"
+
+namespace lima
+{
+namespace PointGrey
+{
+/*******************************************************************
+ * \class Manager
+ * \brief opens several cameras from a single bus enumeration
+ *
+ * The bus is enumerated once when the manager is built, cameras
+ * are then connected by serial number without scanning again. The
+ * manager owns the cameras it creates.
+ *******************************************************************/
+class Manager
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "Manager", "PointGrey");
+
+public:
+    Manager();
+    ~Manager();
+
+    // cameras seen on the bus
+    void getNbBusCameras(int& nb_cameras);
+
+    // same settings and defaults as the Camera constructor
+    Camera *addCamera(const int camera_serial,
+                      const int packet_size = -1,
+                      const int packet_delay = -1,
+                      const int nb_buffers = -1,
+                      const Camera::GrabMode grab_mode = Camera::GrabDriverDefault,
+                      const int grab_timeout = FlyCapture2::TIMEOUT_UNSPECIFIED,
+                      const bool high_perf_retrieve = false,
+                      const std::string& acq_cpus = "",
+                      const Camera::SchedPolicy acq_policy = Camera::SchedFifo,
+                      const int acq_priority = -1);
+    void addCameras(const std::vector<int>& camera_serials);
+    Camera *getCamera(const int camera_serial);
+    void getNbCameras(int& nb_cameras);
+
+    // acquisition thread placement
+    void setCameraCpus(const int camera_serial, const std::string& cpus);
+    void setCameraNode(const int camera_serial, const int node);
+
+    // summed camera bandwidth per network interface, MB/s
+    void getNbNics(int& nb_nics);
+    void getNicBandwidth(const int nic, std::string& name, double& bandwidth);
+    // shared evenly by the cameras of the interface, through
+    // their auto packet delay
+    void setNicBandwidthBudget(const int nic, const double budget);
+
+private:
+    struct Entry
+    {
+        int serial;
+        Camera *camera;
+    };
+
+    Entry *_find(const int camera_serial);
+    static std::string _nicName(Camera *camera);
+    void _getNics(std::vector<std::string>& names, std::vector<double>& bandwidths);
+
+    FlyCapture2::BusManager m_bus_manager;
+    unsigned int m_nb_bus_cameras;
+    std::vector<Entry> m_cameras;
+};
+} // namespace PointGrey
+} // namespace lima
+
+#endif // POINTGREYMANAGER_H
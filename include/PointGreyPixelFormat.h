@@ -0,0 +1,74 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+#ifndef POINTGREYPIXELFORMAT_H
+#define POINTGREYPIXELFORMAT_H
+
+#include <stddef.h>
+
+namespace lima
+{
+namespace PointGrey
+{
+// Point Grey Mono12 packed (two pixels in three bytes, the low
+// nibbles sharing the middle one) to right aligned 16 bit pixels.
+// The widest kernel the CPU supports is picked at static
+// initialization, when the library is loaded.
+void unpackMono12(const unsigned char *src, unsigned short *dst, size_t nb_pixels);
+
+// name of the kernel in use: "avx2", "ssse3" or "scalar"
+const char *unpackMono12Kernel();
+
+// 16 bit byte swap while copying, src and dst may be the same
+void swapBytes16(const unsigned char *src, unsigned char *dst, size_t nb_pixels);
+const char *swapBytes16Kernel();
+
+// colour of the top left 2x2 Bayer tile, row by row
+enum BayerTile {
+    BayerRGGB, BayerGRBG, BayerGBRG, BayerBGGR
+};
+
+// Bilinear demosaic of an 8 bit Bayer mosaic to packed R G B bytes,
+// src_stride in bytes
+void demosaicRGB24(const unsigned char *src, unsigned char *dst,
+                   int width, int height, int src_stride, BayerTile tile);
+const char *demosaicKernel();
+
+// Luminance straight from the mosaic: a 3x3 binomial filter
+// weighs every pixel as (R + 2G + B) / 4 whatever its colour.
+// The SIMD versions may round up by one.
+void bayerLuminance8(const unsigned char *src, unsigned char *dst,
+                     int width, int height, int src_stride);
+void bayerLuminance16(const unsigned short *src, unsigned short *dst,
+                      int width, int height, int src_stride);
+
+// Adds 8 or 16 bit pixels into 32 bit sums, the first frame of a
+// sum overwrites it. Returns how many pixels are at saturation
+// or above.
+size_t accumulate8(const unsigned char *src, unsigned int *sum, size_t nb_pixels,
+                   bool first, unsigned char saturation);
+size_t accumulate16(const unsigned short *src, unsigned int *sum, size_t nb_pixels,
+                    bool first, unsigned short saturation);
+const char *accumulateKernel();
+} // namespace PointGrey
+} // namespace lima
+
+#endif // POINTGREYPIXELFORMAT_H
@@ -0,0 +1,170 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+#ifndef POINTGREYSIMBACKEND_H
+#define POINTGREYSIMBACKEND_H
+
+#include <map>
+#include <vector>
+
+#include "Debug.h"
+#include "ThreadUtils.h"
+#include "PointGreyBackend.h"
+
+namespace lima
+{
+namespace PointGrey
+{
+/*******************************************************************
+ * \class SimBackend
+ * \brief software camera generating frames without any hardware
+ *
+ * Frames are produced at the configured rate, size and pixel format
+ * and can be randomly lost, delivered inconsistent or time out, so
+ * that the acquisition path can be exercised and profiled on any
+ * host.
+ *******************************************************************/
+class SimBackend : public Backend
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "SimBackend", "PointGrey");
+
+public:
+    SimBackend(const int width = 2448,
+               const int height = 2048,
+               const double max_frame_rate = 15.,
+               const bool color = false);
+    virtual ~SimBackend();
+
+    // simulation control
+    void getErrorRates(double& consistency_rate, double& drop_rate, double& timeout_rate);
+    void setErrorRates(double consistency_rate, double drop_rate, double timeout_rate);
+    void getFrameCounter(int& frame_counter);
+
+    // Backend
+    virtual BackendError Disconnect();
+    virtual BackendError GetCameraInfo(FlyCapture2::CameraInfo* pCameraInfo);
+
+    virtual BackendError GetConfiguration(FlyCapture2::FC2Config* pConfig);
+    virtual BackendError SetConfiguration(const FlyCapture2::FC2Config* pConfig);
+
+    virtual BackendError StartCapture();
+    virtual BackendError StopCapture();
+    virtual BackendError RetrieveBuffer(FlyCapture2::Image* pImage);
+
+    virtual BackendError GetPropertyInfo(FlyCapture2::PropertyInfo* pPropInfo);
+    virtual BackendError GetProperty(FlyCapture2::Property* pProp);
+    virtual BackendError SetProperty(const FlyCapture2::Property* pProp);
+
+    virtual BackendError GetTriggerModeInfo(FlyCapture2::TriggerModeInfo* pTriggerModeInfo);
+    virtual BackendError GetTriggerMode(FlyCapture2::TriggerMode* pTriggerMode);
+    virtual BackendError SetTriggerMode(const FlyCapture2::TriggerMode* pTriggerMode);
+    virtual BackendError FireSoftwareTrigger();
+
+    virtual BackendError ReadRegister(unsigned int address, unsigned int* pValue);
+    virtual BackendError WriteRegister(unsigned int address, unsigned int value);
+
+    virtual BackendError GetStats(FlyCapture2::CameraStats* pStats);
+
+    virtual BackendError GetEmbeddedImageInfo(FlyCapture2::EmbeddedImageInfo* pInfo);
+    virtual BackendError SetEmbeddedImageInfo(FlyCapture2::EmbeddedImageInfo* pInfo);
+    virtual BackendError GetImageMetadata(const FlyCapture2::Image* pImage,
+                                          FlyCapture2::TimeStamp* pTimeStamp,
+                                          FlyCapture2::ImageMetadata* pMetadata);
+
+#ifdef USE_GIGE
+    virtual BackendError GetGigEImageSettingsInfo(ImageSettingsInfo_t* pInfo);
+    virtual BackendError GetGigEImageSettings(ImageSettings_t* pSettings);
+    virtual BackendError SetGigEImageSettings(const ImageSettings_t* pSettings);
+    virtual BackendError GetGigEImageBinningSettings(unsigned int* pHorzBinnningValue,
+                                                     unsigned int* pVertBinnningValue);
+    virtual BackendError SetGigEImageBinningSettings(unsigned int horzBinnningValue,
+                                                     unsigned int vertBinnningValue);
+    virtual BackendError DiscoverGigEPacketSize(unsigned int* pPacketSize);
+    virtual BackendError GetGigEProperty(FlyCapture2::GigEProperty* pGigEProp);
+    virtual BackendError SetGigEProperty(const FlyCapture2::GigEProperty* pGigEProp);
+#else
+    virtual BackendError GetFormat7Info(ImageSettingsInfo_t* pInfo, bool* pSupported);
+    virtual BackendError ValidateFormat7Settings(const ImageSettings_t* pSettings,
+                                                 bool* pSettingsAreValid,
+                                                 FlyCapture2::Format7PacketInfo* pPacketInfo);
+    virtual BackendError GetFormat7Configuration(ImageSettings_t* pSettings,
+                                                 unsigned int* pPacketSize,
+                                                 float* pPercentage);
+    virtual BackendError SetFormat7Configuration(const ImageSettings_t* pSettings,
+                                                 unsigned int packetSize);
+#endif
+
+private:
+    void _addProperty(FlyCapture2::PropertyType type,
+                      float min_value, float max_value, float value);
+    void _getMaxSize(unsigned int& width, unsigned int& height);
+    bool _checkImageSettings(const ImageSettings_t& settings);
+    double _getFramePeriod();
+    bool _nextFrame(double now, double& frame_time);
+    bool _draw(double rate);
+    void _fillImage(FlyCapture2::Image* pImage, double frame_time);
+
+    int m_width;
+    int m_height;
+    double m_max_frame_rate;
+
+    double m_consistency_rate;
+    double m_drop_rate;
+    double m_timeout_rate;
+    unsigned int m_seed;
+
+    Cond m_cond;
+    bool m_connected;
+    bool m_capturing;
+    double m_next_frame_time;
+    unsigned int m_frame_counter;
+    unsigned int m_retrieved_frames;
+    FlyCapture2::FC2Config m_config;
+    // BUFFER_FRAMES: frames missed while the buffers were full,
+    // skipped once the buffered ones are retrieved
+    int m_gap_after;
+    int m_gap_frames;
+    double m_epoch;
+    FlyCapture2::EmbeddedImageInfo m_embedded_info;
+    FlyCapture2::TimeStamp m_last_timestamp;
+    FlyCapture2::ImageMetadata m_last_metadata;
+
+    FlyCapture2::CameraInfo m_camera_info;
+    std::map<int, FlyCapture2::Property> m_properties;
+    std::map<int, FlyCapture2::PropertyInfo> m_property_infos;
+    FlyCapture2::TriggerMode m_trigger_mode;
+    // software triggers not turned into frames yet, the last
+    // one completes its exposure at m_trigger_frame_time
+    unsigned int m_pending_triggers;
+    double m_trigger_frame_time;
+    std::map<unsigned int, unsigned int> m_registers;
+    ImageSettings_t m_image_settings;
+#ifdef USE_GIGE
+    unsigned int m_bin_x;
+    unsigned int m_bin_y;
+    std::map<int, unsigned int> m_gige_properties;
+#endif
+    std::vector<unsigned char> m_pattern;
+};
+} // namespace PointGrey
+} // namespace lima
+
+#endif // POINTGREYSIMBACKEND_H
@@ -0,0 +1,207 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include "PointGreyBackend.h"
+
+using namespace lima;
+using namespace lima::PointGrey;
+
+//-----------------------------------------------------
+// FlyCapture2 backend: plain forwarding to the driver
+//-----------------------------------------------------
+BackendError FlyCapBackend::Connect(FlyCapture2::PGRGuid* pGuid)
+{
+    return m_camera.Connect(pGuid);
+}
+
+BackendError FlyCapBackend::Disconnect()
+{
+    return m_camera.Disconnect();
+}
+
+BackendError FlyCapBackend::GetCameraInfo(FlyCapture2::CameraInfo* pCameraInfo)
+{
+    return m_camera.GetCameraInfo(pCameraInfo);
+}
+
+BackendError FlyCapBackend::GetConfiguration(FlyCapture2::FC2Config* pConfig)
+{
+    return m_camera.GetConfiguration(pConfig);
+}
+
+BackendError FlyCapBackend::SetConfiguration(const FlyCapture2::FC2Config* pConfig)
+{
+    return m_camera.SetConfiguration(pConfig);
+}
+
+BackendError FlyCapBackend::StartCapture()
+{
+    return m_camera.StartCapture();
+}
+
+BackendError FlyCapBackend::StopCapture()
+{
+    return m_camera.StopCapture();
+}
+
+BackendError FlyCapBackend::RetrieveBuffer(FlyCapture2::Image* pImage)
+{
+    return m_camera.RetrieveBuffer(pImage);
+}
+
+BackendError FlyCapBackend::GetPropertyInfo(FlyCapture2::PropertyInfo* pPropInfo)
+{
+    return m_camera.GetPropertyInfo(pPropInfo);
+}
+
+BackendError FlyCapBackend::GetProperty(FlyCapture2::Property* pProp)
+{
+    return m_camera.GetProperty(pProp);
+}
+
+BackendError FlyCapBackend::SetProperty(const FlyCapture2::Property* pProp)
+{
+    return m_camera.SetProperty(pProp);
+}
+
+BackendError FlyCapBackend::GetTriggerModeInfo(FlyCapture2::TriggerModeInfo* pTriggerModeInfo)
+{
+    return m_camera.GetTriggerModeInfo(pTriggerModeInfo);
+}
+
+BackendError FlyCapBackend::GetTriggerMode(FlyCapture2::TriggerMode* pTriggerMode)
+{
+    return m_camera.GetTriggerMode(pTriggerMode);
+}
+
+BackendError FlyCapBackend::SetTriggerMode(const FlyCapture2::TriggerMode* pTriggerMode)
+{
+    return m_camera.SetTriggerMode(pTriggerMode);
+}
+
+BackendError FlyCapBackend::FireSoftwareTrigger()
+{
+    return m_camera.FireSoftwareTrigger();
+}
+
+BackendError FlyCapBackend::ReadRegister(unsigned int address, unsigned int* pValue)
+{
+    return m_camera.ReadRegister(address, pValue);
+}
+
+BackendError FlyCapBackend::WriteRegister(unsigned int address, unsigned int value)
+{
+    return m_camera.WriteRegister(address, value);
+}
+
+BackendError FlyCapBackend::GetStats(FlyCapture2::CameraStats* pStats)
+{
+    return m_camera.GetStats(pStats);
+}
+
+BackendError FlyCapBackend::GetEmbeddedImageInfo(FlyCapture2::EmbeddedImageInfo* pInfo)
+{
+    return m_camera.GetEmbeddedImageInfo(pInfo);
+}
+
+BackendError FlyCapBackend::SetEmbeddedImageInfo(FlyCapture2::EmbeddedImageInfo* pInfo)
+{
+    return m_camera.SetEmbeddedImageInfo(pInfo);
+}
+
+BackendError FlyCapBackend::GetImageMetadata(const FlyCapture2::Image* pImage,
+                                             FlyCapture2::TimeStamp* pTimeStamp,
+                                             FlyCapture2::ImageMetadata* pMetadata)
+{
+    *pTimeStamp = pImage->GetTimeStamp();
+    *pMetadata = pImage->GetMetadata();
+    return BackendError();
+}
+
+#ifdef USE_GIGE
+BackendError FlyCapBackend::GetGigEImageSettingsInfo(ImageSettingsInfo_t* pInfo)
+{
+    return m_camera.GetGigEImageSettingsInfo(pInfo);
+}
+
+BackendError FlyCapBackend::GetGigEImageSettings(ImageSettings_t* pSettings)
+{
+    return m_camera.GetGigEImageSettings(pSettings);
+}
+
+BackendError FlyCapBackend::SetGigEImageSettings(const ImageSettings_t* pSettings)
+{
+    return m_camera.SetGigEImageSettings(pSettings);
+}
+
+BackendError FlyCapBackend::GetGigEImageBinningSettings(unsigned int* pHorzBinnningValue,
+                                                        unsigned int* pVertBinnningValue)
+{
+    return m_camera.GetGigEImageBinningSettings(pHorzBinnningValue, pVertBinnningValue);
+}
+
+BackendError FlyCapBackend::SetGigEImageBinningSettings(unsigned int horzBinnningValue,
+                                                        unsigned int vertBinnningValue)
+{
+    return m_camera.SetGigEImageBinningSettings(horzBinnningValue, vertBinnningValue);
+}
+
+BackendError FlyCapBackend::DiscoverGigEPacketSize(unsigned int* pPacketSize)
+{
+    return m_camera.DiscoverGigEPacketSize(pPacketSize);
+}
+
+BackendError FlyCapBackend::GetGigEProperty(FlyCapture2::GigEProperty* pGigEProp)
+{
+    return m_camera.GetGigEProperty(pGigEProp);
+}
+
+BackendError FlyCapBackend::SetGigEProperty(const FlyCapture2::GigEProperty* pGigEProp)
+{
+    return m_camera.SetGigEProperty(pGigEProp);
+}
+#else
+BackendError FlyCapBackend::GetFormat7Info(ImageSettingsInfo_t* pInfo, bool* pSupported)
+{
+    return m_camera.GetFormat7Info(pInfo, pSupported);
+}
+
+BackendError FlyCapBackend::ValidateFormat7Settings(const ImageSettings_t* pSettings,
+                                                    bool* pSettingsAreValid,
+                                                    FlyCapture2::Format7PacketInfo* pPacketInfo)
+{
+    return m_camera.ValidateFormat7Settings(pSettings, pSettingsAreValid, pPacketInfo);
+}
+
+BackendError FlyCapBackend::GetFormat7Configuration(ImageSettings_t* pSettings,
+                                                    unsigned int* pPacketSize,
+                                                    float* pPercentage)
+{
+    return m_camera.GetFormat7Configuration(pSettings, pPacketSize, pPercentage);
+}
+
+BackendError FlyCapBackend::SetFormat7Configuration(const ImageSettings_t* pSettings,
+                                                    unsigned int packetSize)
+{
+    return m_camera.SetFormat7Configuration(pSettings, packetSize);
+}
+#endif
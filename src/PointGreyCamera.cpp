@@ -1,4 +1,11 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
 #include "PointGreyCamera.h"
+#include "PointGreyPixelFormat.h"
 
 using namespace lima;
 using namespace lima::PointGrey;
@@ -15,31 +22,365 @@ public:
     virtual ~_AcqThread();
 protected:
     virtual void threadFunction();
+private:
+    void _applyScheduling();
+
+    Camera &m_cam;
+};
+
+//-----------------------------------------------------
+// _DispatchThread class
+//-----------------------------------------------------
+class Camera::_DispatchThread : public Thread
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "Camera", "_DispatchThread");
+public:
+    _DispatchThread(Camera &aCam);
+    virtual ~_DispatchThread();
+protected:
+    virtual void threadFunction();
+private:
+    void _accumulate(int frame_nb, FlyCapture2::Image *image, const Timestamp& timestamp);
+
+    Camera &m_cam;
+    // camera pixels when they can't be summed straight from the driver
+    std::vector<unsigned char> m_acc_pixels;
+    Timestamp m_acc_timestamp;
+    int m_acc_saturated;
+};
+
+//-----------------------------------------------------
+// _StatsThread class
+//-----------------------------------------------------
+class Camera::_StatsThread : public Thread
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "Camera", "_StatsThread");
+public:
+    _StatsThread(Camera &aCam);
+    virtual ~_StatsThread();
+protected:
+    virtual void threadFunction();
 private:
     Camera &m_cam;
+    Cond m_cond;
+    bool m_quit;
+};
+
+//-----------------------------------------------------
+// _FrameRing class
+//
+// Bounded single producer / single consumer ring joining the
+// retrieve thread to the dispatch thread. Slots are exchanged
+// without locking; the condition is only used to sleep when the
+// ring is empty (consumer) or full (producer).
+//-----------------------------------------------------
+class Camera::_FrameRing
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "Camera", "_FrameRing");
+public:
+    struct Slot
+    {
+        Slot() : image(&own_image) {}
+
+        // own_image, or lima_image when attached to the Lima
+        // buffer of the frame by a direct retrieve
+        FlyCapture2::Image *image;
+        FlyCapture2::Image own_image;
+        FlyCapture2::Image lima_image;
+        int frame_nb;
+        unsigned int frame_counter;
+        Timestamp timestamp;
+        // blank frames to deliver before this one
+        int nb_blank;
+        // false when only the blank frames fit in the acquisition
+        bool valid;
+    };
+
+    _FrameRing(int size);
+    ~_FrameRing();
+
+    // both sides must be idle: the acquisition thread out of its
+    // retrieve loop and the dispatch thread parked, see prepareAcq
+    void reset(int size);
+
+    int size() const { return m_size; }
+    int occupancy() const { return m_head - m_tail; }
+    int highWater() const { return m_high_water; }
+
+    // producer side
+    Slot *producerSlot(double timeout);
+    void push();
+    bool waitEmpty(double timeout);
+
+    // consumer side
+    Slot *consumerSlot(double timeout);
+    void pop();
+
+    void wakeup();
+private:
+    void _signal();
+
+    Slot *m_slots;
+    int m_size;
+    volatile unsigned int m_head;
+    volatile unsigned int m_tail;
+    volatile int m_high_water;
+    volatile bool m_producer_waiting;
+    volatile bool m_consumer_waiting;
+    Cond m_cond;
 };
 
+//-----------------------------------------------------
+// Linux cpu list ("0-3,8"), empty for all cpus
+//-----------------------------------------------------
+static bool _parseCpuList(const std::string& cpus, cpu_set_t& set)
+{
+    CPU_ZERO(&set);
+    if (cpus.empty())
+    {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            CPU_SET(cpu, &set);
+        return true;
+    }
+
+    const char *p = cpus.c_str();
+    while (*p)
+    {
+        char *end;
+        long first = strtol(p, &end, 10);
+        if (end == p)
+            return false;
+        long last = first;
+        p = end;
+        if (*p == '-')
+        {
+            last = strtol(++p, &end, 10);
+            if (end == p)
+                return false;
+            p = end;
+        }
+        if (first < 0 || last < first || last >= CPU_SETSIZE)
+            return false;
+        for (long cpu = first; cpu <= last; ++cpu)
+            CPU_SET(cpu, &set);
+        if (*p == ',')
+            ++p;
+        else if (*p)
+            return false;
+    }
+    return true;
+}
+
+static std::string _formatCpuList(const cpu_set_t& set)
+{
+    std::string cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    {
+        if (!CPU_ISSET(cpu, &set))
+            continue;
+        int last = cpu;
+        while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, &set))
+            ++last;
+
+        char range[32];
+        if (last == cpu)
+            snprintf(range, sizeof(range), "%d", cpu);
+        else
+            snprintf(range, sizeof(range), "%d-%d", cpu, last);
+        if (!cpus.empty())
+            cpus += ",";
+        cpus += range;
+        cpu = last;
+    }
+    return cpus;
+}
+
+//-----------------------------------------------------
+// camera GUID as four hex words, "xxxxxxxx-...-xxxxxxxx"
+//-----------------------------------------------------
+static bool _parseGuid(const std::string& text, FlyCapture2::PGRGuid& guid)
+{
+    char end;
+    return sscanf(text.c_str(), "%x-%x-%x-%x%c", &guid.value[0], &guid.value[1],
+                  &guid.value[2], &guid.value[3], &end) == 4;
+}
+
+static bool _parseIPAddress(const std::string& text, FlyCapture2::IPAddress& address)
+{
+    unsigned int octets[4];
+    char end;
+    if (sscanf(text.c_str(), "%u.%u.%u.%u%c", &octets[0], &octets[1],
+               &octets[2], &octets[3], &end) != 4)
+        return false;
+    for (int i = 0; i < 4; ++i)
+    {
+        if (octets[i] > 255)
+            return false;
+        address.octets[i] = octets[i];
+    }
+    return true;
+}
+
+static int _posixSchedPolicy(Camera::SchedPolicy policy)
+{
+    switch (policy)
+    {
+    case Camera::SchedFifo: return SCHED_FIFO;
+    case Camera::SchedRR:   return SCHED_RR;
+    default:                return SCHED_OTHER;
+    }
+}
+
+static Camera::SchedPolicy _cameraSchedPolicy(int policy)
+{
+    switch (policy)
+    {
+    case SCHED_FIFO: return Camera::SchedFifo;
+    case SCHED_RR:   return Camera::SchedRR;
+    default:         return Camera::SchedOther;
+    }
+}
+
+static BayerTile _getBayerTile(FlyCapture2::BayerTileFormat format)
+{
+    switch (format)
+    {
+    case FlyCapture2::GRBG: return BayerGRBG;
+    case FlyCapture2::GBRG: return BayerGBRG;
+    case FlyCapture2::BGGR: return BayerBGGR;
+    default:                return BayerRGGB;
+    }
+}
+
+//-----------------------------------------------------
+// driver image to Lima frame buffer
+//-----------------------------------------------------
+static void _copyImage(FlyCapture2::Image& image, void *dst, int size,
+                       bool swap16, bool rgb, bool luminance)
+{
+    FlyCapture2::PixelFormat format = image.GetPixelFormat();
+    unsigned int rows = image.GetRows();
+    unsigned int cols = image.GetCols();
+    unsigned int stride = image.GetStride();
+    unsigned char *src = image.GetData();
+
+    switch (format)
+    {
+    case FlyCapture2::PIXEL_FORMAT_MONO12:
+    {
+        unsigned short *pixels = (unsigned short *) dst;
+        if (stride * 2 == cols * 3)
+            // no row padding, unpack in one go
+            unpackMono12(src, pixels, size_t(rows) * cols);
+        else
+            for (unsigned int row = 0; row < rows; ++row, src += stride, pixels += cols)
+                unpackMono12(src, pixels, cols);
+        return;
+    }
+    case FlyCapture2::PIXEL_FORMAT_MONO16:
+        if (swap16)
+        {
+            // in place for frames retrieved into the Lima buffer
+            swapBytes16(src, (unsigned char *) dst, size / 2);
+            return;
+        }
+        break;
+    case FlyCapture2::PIXEL_FORMAT_RAW8:
+        if (rgb)
+        {
+            demosaicRGB24(src, (unsigned char *) dst, cols, rows, stride,
+                          _getBayerTile(image.GetBayerTileFormat()));
+            return;
+        }
+        if (luminance)
+        {
+            bayerLuminance8(src, (unsigned char *) dst, cols, rows, stride);
+            return;
+        }
+        break;
+    case FlyCapture2::PIXEL_FORMAT_RAW16:
+        if (swap16 && luminance)
+            swapBytes16(src, src, size_t(rows) * stride / 2);
+        else if (swap16)
+        {
+            swapBytes16(src, (unsigned char *) dst, size / 2);
+            return;
+        }
+        if (luminance)
+        {
+            bayerLuminance16((unsigned short *) src, (unsigned short *) dst, cols, rows, stride);
+            return;
+        }
+        break;
+    default:
+        break;
+    }
+
+    if (src != dst)
+        memcpy(dst, src, size);
+}
+
+// image data format, bit 0 selects the Y16 byte order
+static const unsigned int IMAGE_DATA_FORMAT_REG = 0x1048;
+
+static const int DEFAULT_RING_SIZE = 16;
+static const double RING_WAIT_TIMEOUT = 0.1;
+
+// longest driver retrieve, ms: a stop is seen within that
+// time even when no frame comes
+static const int RETRIEVE_POLL_TIMEOUT = 100;
+// how long stopAcq waits for the acquisition thread, seconds
+static const double STOP_TIMEOUT = 2.;
+
+// IIDC trigger modes: one exposure per edge, exposure as long
+// as the pulse, and a burst of frames per edge
+static const unsigned int TRIGGER_MODE_EDGE = 0;
+static const unsigned int TRIGGER_MODE_BULB = 1;
+static const unsigned int TRIGGER_MODE_MULTI_SHOT = 15;
+// the burst length is a 12 bit trigger parameter
+static const int MULTI_SHOT_MAX_FRAMES = 0xfff;
+// trigger source 7 is the software trigger, fired by a write
+// to the register whose bit 31 stays set until it is ready again
+static const unsigned int TRIGGER_SOURCE_SOFTWARE = 7;
+static const unsigned int SOFTWARE_TRIGGER_REG = 0x62c;
+static const double SOFTWARE_TRIGGER_READY_TIMEOUT = 1.;
+
+// auto packet delay: seconds between adjustments, and clean
+// periods before the delay is lowered again
+static const double PACKET_DELAY_TUNE_PERIOD = 0.5;
+static const int PACKET_DELAY_CLEAN_PERIODS = 4;
+
+// accumulated camera frames: 16 bit pixels keep within 32 bits
+static const int ACC_MAX_FRAMES = 65536;
+
+// seconds between driver statistics polls while acquiring
+static const double STATS_POLL_PERIOD = 1.;
+
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
 Camera::Camera(const int camera_serial,
                const int packet_size,
-               const int packet_delay)
-    : m_nb_frames(1)
-    , m_status(Ready)
-    , m_quit(false)
-    , m_acq_started(false)
-    , m_thread_running(true)
-    , m_image_number(0)
-    , m_camera(NULL)
+               const int packet_delay,
+               const int nb_buffers,
+               const GrabMode grab_mode,
+               const int grab_timeout,
+               const bool high_perf_retrieve,
+               const std::string& acq_cpus,
+               const SchedPolicy acq_policy,
+               const int acq_priority)
 {
     DEB_CONSTRUCTOR();
+    _initMembers(acq_cpus, acq_policy, acq_priority);
 
+    Timestamp t0 = Timestamp::now();
     FlyCapture2::BusManager busmgr;
     FlyCapture2::PGRGuid pgrguid;
 
     unsigned int nb_cameras;
-    m_camera = new Camera_t();
+    FlyCapBackend *camera = new FlyCapBackend();
+    BackendGuard camera_guard(camera);
+    m_camera = camera;
 
     m_error = busmgr.GetNumOfCameras(&nb_cameras);
     if (m_error != FlyCapture2::PGRERROR_OK)
@@ -52,9 +393,198 @@ Camera::Camera(const int camera_serial,
     if (m_error != FlyCapture2::PGRERROR_OK)
         THROW_HW_ERROR(Error) << "Camera not found: " << m_error.GetDescription();
 
-    m_error = m_camera->Connect(&pgrguid);
+    m_error = camera->Connect(&pgrguid);
     if (m_error != FlyCapture2::PGRERROR_OK)
         THROW_HW_ERROR(Error) << "Failed to connect to camera: " << m_error.GetDescription();
+    m_guid = _formatGuid(pgrguid);
+    m_connect_time = Timestamp::now() - t0;
+
+    _init(packet_size, packet_delay, nb_buffers, grab_mode, grab_timeout, high_perf_retrieve);
+    camera_guard.release();
+}
+
+//-----------------------------------------------------
+// the backend is owned once the camera is built, it is
+// left to the caller if the constructor throws
+//-----------------------------------------------------
+Camera::Camera(Backend *backend,
+               const int packet_size,
+               const int packet_delay,
+               const int nb_buffers,
+               const GrabMode grab_mode,
+               const int grab_timeout,
+               const bool high_perf_retrieve,
+               const std::string& acq_cpus,
+               const SchedPolicy acq_policy,
+               const int acq_priority)
+{
+    DEB_CONSTRUCTOR();
+    _initMembers(acq_cpus, acq_policy, acq_priority);
+    m_camera = backend;
+    _init(packet_size, packet_delay, nb_buffers, grab_mode, grab_timeout, high_perf_retrieve);
+}
+
+//-----------------------------------------------------
+// member setup shared by the constructors, in
+// declaration order
+//-----------------------------------------------------
+void Camera::_initMembers(const std::string& acq_cpus, SchedPolicy acq_policy, int acq_priority)
+{
+    m_status = Ready;
+    m_nb_frames = 1;
+    m_image_number = 0;
+    m_dispatched_frames = 0;
+    m_acq_thread = NULL;
+    m_dispatch_thread = NULL;
+    m_stats_thread = NULL;
+    m_ring = NULL;
+    m_ring_size = DEFAULT_RING_SIZE;
+    m_quit = false;
+    m_acq_started = false;
+    m_stream_open = false;
+    m_thread_running = true;
+    m_retrieving = false;
+    m_dispatch_continue = true;
+    m_dispatch_park = false;
+    m_dispatch_idle = false;
+    m_direct_retrieve = false;
+    m_stream_config_changed = false;
+    m_armed_idle = false;
+    m_deferred_config = false;
+    m_hw_timestamp = false;
+    m_hw_frame_counter = false;
+    m_last_frame_counter = 0;
+
+    m_acq_cpus = acq_cpus;
+    m_acq_policy = acq_policy;
+    m_acq_priority = acq_priority;
+    m_acq_sched_changed = true;
+    m_applied_acq_policy = SchedOther;
+    m_applied_acq_priority = 0;
+    m_acq_bytes = 0;
+    m_auto_packet_delay = false;
+    m_bandwidth_budget = 0;
+    m_tune_time = 0;
+    m_tune_bytes = 0;
+    m_tune_resends = 0;
+    m_tune_dropped = 0;
+    m_tune_clean = 0;
+
+    m_y16_swap = false;
+    m_y16_native_valid = false;
+    m_bayer_mode = BayerOff;
+    m_bayer_rgb = false;
+    m_acc_nb_frames = 1;
+    m_acc_last_saturated = 0;
+    m_acc_saturated_frames = 0;
+    m_latency_stats = false;
+
+    m_drop_policy = DropSkip;
+    m_dropped_frames = 0;
+    m_inconsistent_frames = 0;
+    m_start_stats_valid = false;
+    m_polled_stats_valid = false;
+    m_applied_trig_mode = -1;
+    m_trigger_mode_info_valid = false;
+    m_trigger_time = 0;
+    m_trigger_latency = -1;
+    m_stop_latency = -1;
+
+    m_camera = NULL;
+    m_connect_time = 0;
+    m_init_time = 0;
+}
+
+//-----------------------------------------------------
+// The driver is asked for this camera only, the bus is
+// enumerated if that fails
+//-----------------------------------------------------
+Camera *Camera::open(const std::string& camera_address,
+                     const int packet_size,
+                     const int packet_delay,
+                     const int nb_buffers,
+                     const GrabMode grab_mode,
+                     const int grab_timeout,
+                     const bool high_perf_retrieve,
+                     const std::string& acq_cpus,
+                     const SchedPolicy acq_policy,
+                     const int acq_priority)
+{
+    DEB_STATIC_FUNCT();
+    DEB_PARAM() << DEB_VAR1(camera_address);
+
+    Timestamp t0 = Timestamp::now();
+    FlyCapture2::BusManager busmgr;
+    FlyCapture2::PGRGuid pgrguid;
+    FlyCapture2::IPAddress ip_address;
+    FlyCapture2::Error error;
+
+    bool by_ip = _parseIPAddress(camera_address, ip_address);
+    if (by_ip)
+    {
+        error = busmgr.GetCameraFromIPAddress(ip_address, &pgrguid);
+        if (error != FlyCapture2::PGRERROR_OK)
+        {
+            DEB_WARNING() << "Camera " << camera_address << " not found, rescanning the bus";
+            error = busmgr.RescanBus();
+            if (error == FlyCapture2::PGRERROR_OK)
+                error = busmgr.GetCameraFromIPAddress(ip_address, &pgrguid);
+        }
+        if (error != FlyCapture2::PGRERROR_OK)
+            THROW_HW_ERROR(Error) << "Camera not found: " << error.GetDescription();
+    }
+    else if (!_parseGuid(camera_address, pgrguid))
+        THROW_HW_ERROR(InvalidValue) << "Invalid camera address " << DEB_VAR1(camera_address);
+
+    FlyCapBackend *backend = new FlyCapBackend();
+    BackendGuard backend_guard(backend);
+    BackendError backend_error = backend->Connect(&pgrguid);
+    if (backend_error != FlyCapture2::PGRERROR_OK && !by_ip)
+    {
+        // the driver may not know the GUID before a bus scan
+        DEB_WARNING() << "Camera " << camera_address << " not found, enumerating the bus";
+        unsigned int nb_cameras;
+        error = busmgr.GetNumOfCameras(&nb_cameras);
+        if (error == FlyCapture2::PGRERROR_OK)
+            backend_error = backend->Connect(&pgrguid);
+    }
+    if (backend_error != FlyCapture2::PGRERROR_OK)
+        THROW_HW_ERROR(Error) << "Failed to connect to camera: " << backend_error.GetDescription();
+    double connect_time = Timestamp::now() - t0;
+
+    Camera *camera = new Camera(backend, packet_size, packet_delay, nb_buffers, grab_mode,
+                                grab_timeout, high_perf_retrieve, acq_cpus, acq_policy,
+                                acq_priority);
+    backend_guard.release();
+    camera->m_guid = _formatGuid(pgrguid);
+    camera->m_connect_time = connect_time;
+    return camera;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+std::string Camera::_formatGuid(const FlyCapture2::PGRGuid& guid)
+{
+    char text[40];
+    snprintf(text, sizeof(text), "%08x-%08x-%08x-%08x",
+             guid.value[0], guid.value[1], guid.value[2], guid.value[3]);
+    return text;
+}
+
+//-----------------------------------------------------
+// common setup of a connected camera
+//-----------------------------------------------------
+void Camera::_init(int packet_size, int packet_delay, int nb_buffers,
+                   GrabMode grab_mode, int grab_timeout, bool high_perf_retrieve)
+{
+    DEB_MEMBER_FUNCT();
+    Timestamp t0 = Timestamp::now();
+
+    // acquisition thread settings, checked before it starts
+    setAcqCpus(m_acq_cpus);
+    setAcqSchedPolicy(m_acq_policy);
+    setAcqSchedPriority(m_acq_priority);
 
     m_error = m_camera->GetCameraInfo(&m_camera_info);
     if (m_error != FlyCapture2::PGRERROR_OK)
@@ -62,10 +592,43 @@ Camera::Camera(const int camera_serial,
 
     if (packet_size > 0)
         setPacketSize(packet_size);
+    else if (packet_size == 0)
+        discoverPacketSize(packet_size);
 
     if (packet_delay > 0)
         setPacketDelay(packet_delay);
 
+    // stream configuration, written at the first start
+    m_error = m_camera->GetConfiguration(&m_stream_config);
+    if (m_error != FlyCapture2::PGRERROR_OK)
+        THROW_HW_ERROR(Error) << "Failed to get camera configuration: " << m_error.GetDescription();
+
+    if (nb_buffers > 0)
+        setNbBuffers(nb_buffers);
+    if (grab_mode != GrabDriverDefault)
+        setGrabMode(grab_mode);
+    if (grab_timeout != FlyCapture2::TIMEOUT_UNSPECIFIED)
+        setGrabTimeout(grab_timeout);
+    setHighPerfRetrieve(high_perf_retrieve);
+
+#ifdef USE_GIGE
+    // Start unbinned, the image settings info depends on it
+    unsigned int bin_x, bin_y;
+    m_error = m_camera->GetGigEImageBinningSettings(&bin_x, &bin_y);
+    if (m_error != FlyCapture2::PGRERROR_OK)
+        THROW_HW_ERROR(Error) << "Failed to get binning settings: " << m_error.GetDescription();
+    if (bin_x != 1 || bin_y != 1)
+    {
+        m_error = m_camera->SetGigEImageBinningSettings(1, 1);
+        if (m_error != FlyCapture2::PGRERROR_OK)
+            THROW_HW_ERROR(Error) << "Failed to reset binning: " << m_error.GetDescription();
+    }
+    // probed while nothing streams, checkBin then only reads it
+    _getBinList();
+#else
+    m_image_settings.mode = FlyCapture2::MODE_0;
+#endif
+
     _getImageSettingsInfo();
 
     // Setup default image format
@@ -75,11 +638,36 @@ Camera::Camera(const int camera_serial,
     m_image_settings.height = m_image_settings_info.maxHeight;
     m_image_settings.pixelFormat = FlyCapture2::PIXEL_FORMAT_MONO8;
 
-    _applyImageSettings();
+    // left alone when the camera already runs with it
+    if (!_isImageSettingsApplied())
+        _applyImageSettings();
+
+    // The embedded timestamp and frame counter overwrite the
+    // first pixels, off until setHwTimestamp asks for them
+    try
+    {
+        _setEmbeddedImageInfo(false);
+    }
+    catch (Exception &e)
+    {
+        DEB_WARNING() << "Unable to clear embedded image info: " << e.getErrDesc();
+    }
+
+    m_ring = new _FrameRing(m_ring_size);
+
+    // Dispatch thread, fed by the acquisition thread
+    m_dispatch_thread = new _DispatchThread(*this);
+    m_dispatch_thread->start();
 
     //Acquisition  Thread
     m_acq_thread = new _AcqThread(*this);
     m_acq_thread->start();
+
+    m_stats_thread = new _StatsThread(*this);
+    m_stats_thread->start();
+
+    m_init_time = Timestamp::now() - t0;
+    DEB_TRACE() << DEB_VAR3(m_guid, m_connect_time, m_init_time);
 }
 
 //-----------------------------------------------------
@@ -88,7 +676,19 @@ Camera::Camera(const int camera_serial,
 Camera::~Camera()
 {
     DEB_DESTRUCTOR();
+
+    // an open stream would keep the acquisition thread retrieving
+    AutoMutex lock(m_cond.mutex());
+    bool stream_open = m_stream_open;
+    m_stream_open = false;
+    lock.unlock();
+    if (stream_open)
+        m_camera->StopCapture();
+
+    delete m_stats_thread;
     delete m_acq_thread;
+    delete m_dispatch_thread;
+    delete m_ring;
     m_camera->Disconnect();
     delete m_camera;
 }
@@ -99,17 +699,54 @@ Camera::~Camera()
 void Camera::_getImageSettingsInfo()
 {
     DEB_MEMBER_FUNCT();
+    std::pair<int, int> key(m_bin.getX(), m_bin.getY());
+    ImageSettingsInfoCache::iterator i = m_image_settings_info_cache.find(key);
+    if (i != m_image_settings_info_cache.end())
+    {
+        m_image_settings_info = i->second;
+        return;
+    }
+
 #ifdef USE_GIGE
     m_error = m_camera->GetGigEImageSettingsInfo(&m_image_settings_info);
 #else
     bool fmt7_supported;
-    m_image_settings_info.mode = FlyCapture2::MODE_0;
+    m_image_settings_info.mode = m_image_settings.mode;
     m_error = m_camera->GetFormat7Info(&m_image_settings_info, &fmt7_supported);
     if (!fmt7_supported)
         THROW_HW_ERROR(Error) << "Format7 is not supported";
 #endif
     if (m_error != FlyCapture2::PGRERROR_OK)
         THROW_HW_ERROR(Error) << "Failed to get Format7 info: " << m_error.GetDescription();
+
+    m_image_settings_info_cache[key] = m_image_settings_info;
+}
+
+//-----------------------------------------------------
+// whether the camera image settings are already ours
+//-----------------------------------------------------
+bool Camera::_isImageSettingsApplied()
+{
+    DEB_MEMBER_FUNCT();
+    ImageSettings_t current;
+#ifdef USE_GIGE
+    BackendError error = m_camera->GetGigEImageSettings(&current);
+#else
+    unsigned int packet_size;
+    float percentage;
+    BackendError error = m_camera->GetFormat7Configuration(&current, &packet_size, &percentage);
+#endif
+    if (error != FlyCapture2::PGRERROR_OK)
+        return false;
+
+    return current.offsetX == m_image_settings.offsetX &&
+           current.offsetY == m_image_settings.offsetY &&
+           current.width == m_image_settings.width &&
+           current.height == m_image_settings.height &&
+#ifndef USE_GIGE
+           current.mode == m_image_settings.mode &&
+#endif
+           current.pixelFormat == m_image_settings.pixelFormat;
 }
 
 //-----------------------------------------------------
@@ -118,6 +755,7 @@ void Camera::_getImageSettingsInfo()
 void Camera::_applyImageSettings()
 {
     DEB_MEMBER_FUNCT();
+    _closeIdleStream();
 #ifdef USE_GIGE
     m_error = m_camera->SetGigEImageSettings(&m_image_settings);
 #else
@@ -136,9 +774,81 @@ void Camera::_applyImageSettings()
     if (m_error != FlyCapture2::PGRERROR_OK)
         THROW_HW_ERROR(Error) << "Unable to apply image format settings: " << m_error.GetDescription();
 
-    if (m_image_settings.pixelFormat == FlyCapture2::PIXEL_FORMAT_MONO16)
-        // Force the camera to PGR's Y16 endianness
+    // frame rate and exposure limits depend on the image format
+    refreshProperties();
+
+    if ((m_image_settings.pixelFormat == FlyCapture2::PIXEL_FORMAT_MONO16 ||
+         m_image_settings.pixelFormat == FlyCapture2::PIXEL_FORMAT_RAW16) && !m_y16_swap)
+    {
+        // Force the camera to PGR's Y16 endianness, or swap the
+        // bytes on the host when the camera can't
+        try
+        {
+            _forcePGRY16Mode();
+        }
+        catch (Exception &e)
+        {
+            DEB_WARNING() << "Swapping Y16 bytes on the host: " << e.getErrDesc();
+            m_y16_swap = true;
+        }
+    }
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getY16ByteSwap(bool& y16_swap)
+{
+    DEB_MEMBER_FUNCT();
+    y16_swap = m_y16_swap;
+    DEB_RETURN() << DEB_VAR1(y16_swap);
+}
+
+//-----------------------------------------------------
+// Host side swap leaves the camera in its native Y16 byte
+// order, restored if it was changed
+//-----------------------------------------------------
+void Camera::setY16ByteSwap(bool y16_swap)
+{
+    DEB_MEMBER_FUNCT();
+    DEB_PARAM() << DEB_VAR1(y16_swap);
+
+    if (m_acq_started)
+        THROW_HW_ERROR(Error) << "Acquisition in progress";
+
+    if (y16_swap && m_y16_native_valid)
+    {
+        m_error = m_camera->WriteRegister(IMAGE_DATA_FORMAT_REG, m_y16_native);
+        if (m_error != FlyCapture2::PGRERROR_OK)
+            THROW_HW_ERROR(Error) << "Failed to write camera register: " << m_error.GetDescription();
+        m_y16_native_valid = false;
+    }
+    else if (!y16_swap && (m_image_settings.pixelFormat == FlyCapture2::PIXEL_FORMAT_MONO16 ||
+                           m_image_settings.pixelFormat == FlyCapture2::PIXEL_FORMAT_RAW16))
         _forcePGRY16Mode();
+
+    m_y16_swap = y16_swap;
+}
+
+//-----------------------------------------------------
+// empty for a camera given as a backend
+//-----------------------------------------------------
+void Camera::getCameraGuid(std::string& guid)
+{
+    DEB_MEMBER_FUNCT();
+    guid = m_guid;
+    DEB_RETURN() << DEB_VAR1(guid);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getStartupTime(double& connect_time, double& init_time)
+{
+    DEB_MEMBER_FUNCT();
+    connect_time = m_connect_time;
+    init_time = m_init_time;
+    DEB_RETURN() << DEB_VAR2(connect_time, init_time);
 }
 
 //-----------------------------------------------------
@@ -168,60 +878,1127 @@ void Camera::setPacketSize(int packet_size)
     DEB_MEMBER_FUNCT();
     DEB_PARAM() << DEB_VAR1(packet_size);
 #ifdef USE_GIGE
+    _closeIdleStream();
     FlyCapture2::GigEProperty property;
     property.propType = FlyCapture2::PACKET_SIZE;
     property.value = packet_size;
 
-    m_error = m_camera->SetGigEProperty(&property);
-    if (m_error != FlyCapture2::PGRERROR_OK)
-        THROW_HW_ERROR(Error) << "Failed to set PACKET_SIZE property: " << m_error.GetDescription();
-#endif
+    m_error = m_camera->SetGigEProperty(&property);
+    if (m_error != FlyCapture2::PGRERROR_OK)
+        THROW_HW_ERROR(Error) << "Failed to set PACKET_SIZE property: " << m_error.GetDescription();
+#endif
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getPacketDelay(int& packet_delay)
+{
+    DEB_MEMBER_FUNCT();
+#ifdef USE_GIGE
+    FlyCapture2::GigEProperty property;
+    property.propType = FlyCapture2::PACKET_DELAY;
+
+    m_error = m_camera->GetGigEProperty(&property);
+    if (m_error != FlyCapture2::PGRERROR_OK)
+        THROW_HW_ERROR(Error) << "Failed to get PACKET_DELAY property: " << m_error.GetDescription();
+
+    packet_delay = property.value;
+    DEB_RETURN() << DEB_VAR1(packet_delay);
+#endif
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::setPacketDelay(int packet_delay)
+{
+    DEB_MEMBER_FUNCT();
+    DEB_PARAM() << DEB_VAR1(packet_delay);
+#ifdef USE_GIGE
+    FlyCapture2::GigEProperty property;
+    property.propType = FlyCapture2::PACKET_DELAY;
+    property.value = packet_delay;
+
+    m_error = m_camera->SetGigEProperty(&property);
+    if (m_error != FlyCapture2::PGRERROR_OK)
+        THROW_HW_ERROR(Error) << "Failed to set PACKET_DELAY property: " << m_error.GetDescription();
+#endif
+}
+
+//-----------------------------------------------------
+// Jumbo frames are only found when every hop carries them
+//-----------------------------------------------------
+void Camera::discoverPacketSize(int& packet_size)
+{
+    DEB_MEMBER_FUNCT();
+#ifdef USE_GIGE
+    unsigned int discovered;
+    m_error = m_camera->DiscoverGigEPacketSize(&discovered);
+    if (m_error != FlyCapture2::PGRERROR_OK)
+        THROW_HW_ERROR(Error) << "Failed to discover packet size: " << m_error.GetDescription();
+
+    packet_size = discovered;
+    setPacketSize(packet_size);
+    DEB_RETURN() << DEB_VAR1(packet_size);
+#endif
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getAutoPacketDelay(bool& auto_packet_delay)
+{
+    DEB_MEMBER_FUNCT();
+    auto_packet_delay = m_auto_packet_delay;
+    DEB_RETURN() << DEB_VAR1(auto_packet_delay);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::setAutoPacketDelay(bool auto_packet_delay)
+{
+    DEB_MEMBER_FUNCT();
+    DEB_PARAM() << DEB_VAR1(auto_packet_delay);
+
+    if (m_acq_started)
+        THROW_HW_ERROR(Error) << "Acquisition in progress";
+#ifndef USE_GIGE
+    if (auto_packet_delay)
+        THROW_HW_ERROR(NotSupported) << "No packet delay on this camera";
+#endif
+    m_auto_packet_delay = auto_packet_delay;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getBandwidthBudget(double& budget)
+{
+    DEB_MEMBER_FUNCT();
+    budget = m_bandwidth_budget;
+    DEB_RETURN() << DEB_VAR1(budget);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::setBandwidthBudget(double budget)
+{
+    DEB_MEMBER_FUNCT();
+    DEB_PARAM() << DEB_VAR1(budget);
+
+    if (budget < 0)
+        THROW_HW_ERROR(InvalidValue) << "Invalid bandwidth budget " << DEB_VAR1(budget);
+    m_bandwidth_budget = budget;
+}
+
+//-----------------------------------------------------
+// Called by the acquisition thread each tune period: the
+// delay backs off quickly on resends, drops or an exceeded
+// budget, and comes back slowly once the link stays clean
+//-----------------------------------------------------
+void Camera::_tunePacketDelay(double now)
+{
+    DEB_MEMBER_FUNCT();
+#ifdef USE_GIGE
+    FlyCapture2::CameraStats stats;
+    BackendError error = m_camera->GetStats(&stats);
+    if (error != FlyCapture2::PGRERROR_OK)
+    {
+        DEB_WARNING() << "Unable to get camera statistics: " << error.GetDescription();
+        m_tune_time = now;
+        return;
+    }
+
+    bool trouble = (stats.numResendPacketsRequested != m_tune_resends ||
+                    stats.imageDropped != m_tune_dropped);
+    double bandwidth = (m_acq_bytes - m_tune_bytes) / (now - m_tune_time) / 1E6;
+    bool over_budget = (m_bandwidth_budget > 0 && bandwidth > m_bandwidth_budget);
+    bool under_budget = (m_bandwidth_budget <= 0 || bandwidth < 0.9 * m_bandwidth_budget);
+    m_tune_resends = stats.numResendPacketsRequested;
+    m_tune_dropped = stats.imageDropped;
+    m_tune_bytes = m_acq_bytes;
+    m_tune_time = now;
+
+    FlyCapture2::GigEProperty property;
+    property.propType = FlyCapture2::PACKET_DELAY;
+    error = m_camera->GetGigEProperty(&property);
+    if (error != FlyCapture2::PGRERROR_OK)
+    {
+        DEB_WARNING() << "Failed to get PACKET_DELAY property: " << error.GetDescription();
+        return;
+    }
+
+    unsigned int step = (property.max - property.min) / 100 + 1;
+    unsigned int delay = property.value;
+    if (trouble || over_budget)
+    {
+        delay += delay / 4 + step;
+        m_tune_clean = 0;
+    }
+    else if (++m_tune_clean >= PACKET_DELAY_CLEAN_PERIODS && under_budget)
+    {
+        delay = (delay > property.min + step) ? delay - step : property.min;
+        m_tune_clean = 0;
+    }
+    if (delay > property.max)
+        delay = property.max;
+    if (delay == property.value)
+        return;
+
+    DEB_TRACE() << DEB_VAR4(trouble, bandwidth, property.value, delay);
+    property.value = delay;
+    error = m_camera->SetGigEProperty(&property);
+    if (error != FlyCapture2::PGRERROR_OK)
+        DEB_WARNING() << "Failed to set PACKET_DELAY property: " << error.GetDescription();
+#endif
+}
+
+//-----------------------------------------------------
+// driver stream configuration
+//-----------------------------------------------------
+void Camera::getNbBuffers(int& nb_buffers)
+{
+    DEB_MEMBER_FUNCT();
+    nb_buffers = m_stream_config.numBuffers;
+    DEB_RETURN() << DEB_VAR1(nb_buffers);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::setNbBuffers(int nb_buffers)
+{
+    DEB_MEMBER_FUNCT();
+    DEB_PARAM() << DEB_VAR1(nb_buffers);
+
+    if (m_acq_started)
+        THROW_HW_ERROR(Error) << "Acquisition in progress";
+    if (nb_buffers < 1)
+        THROW_HW_ERROR(InvalidValue) << "Invalid number of buffers " << DEB_VAR1(nb_buffers);
+
+    m_stream_config.numBuffers = nb_buffers;
+    m_stream_config_changed = true;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getGrabMode(GrabMode& grab_mode)
+{
+    DEB_MEMBER_FUNCT();
+    switch (m_stream_config.grabMode)
+    {
+    case FlyCapture2::DROP_FRAMES:   grab_mode = GrabDropFrames; break;
+    case FlyCapture2::BUFFER_FRAMES: grab_mode = GrabBufferFrames; break;
+    default:                         grab_mode = GrabDriverDefault; break;
+    }
+    DEB_RETURN() << DEB_VAR1(grab_mode);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::setGrabMode(GrabMode grab_mode)
+{
+    DEB_MEMBER_FUNCT();
+    DEB_PARAM() << DEB_VAR1(grab_mode);
+
+    if (m_acq_started)
+        THROW_HW_ERROR(Error) << "Acquisition in progress";
+
+    switch (grab_mode)
+    {
+    case GrabDriverDefault:
+        m_stream_config.grabMode = FlyCapture2::UNSPECIFIED_GRAB_MODE;
+        break;
+    case GrabDropFrames:
+        m_stream_config.grabMode = FlyCapture2::DROP_FRAMES;
+        break;
+    case GrabBufferFrames:
+        m_stream_config.grabMode = FlyCapture2::BUFFER_FRAMES;
+        break;
+    default:
+        THROW_HW_ERROR(InvalidValue) << "Invalid grab mode " << DEB_VAR1(grab_mode);
+    }
+    m_stream_config_changed = true;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getGrabTimeout(int& grab_timeout)
+{
+    DEB_MEMBER_FUNCT();
+    grab_timeout = m_stream_config.grabTimeout;
+    DEB_RETURN() << DEB_VAR1(grab_timeout);
+}
+
+//-----------------------------------------------------
+// longest wait for a frame, ms, from the start or the
+// previous frame; the acquisition is then stopped with
+// a Fault status, TIMEOUT_INFINITE waits as long as the
+// acquisition runs. The driver itself is only given
+// RETRIEVE_POLL_TIMEOUT, see _applyStreamConfig
+//-----------------------------------------------------
+void Camera::setGrabTimeout(int grab_timeout)
+{
+    DEB_MEMBER_FUNCT();
+    DEB_PARAM() << DEB_VAR1(grab_timeout);
+
+    if (m_acq_started)
+        THROW_HW_ERROR(Error) << "Acquisition in progress";
+    if (grab_timeout < 0 && grab_timeout != FlyCapture2::TIMEOUT_INFINITE)
+        THROW_HW_ERROR(InvalidValue) << "Invalid grab timeout " << DEB_VAR1(grab_timeout);
+
+    m_stream_config.grabTimeout = grab_timeout;
+    m_stream_config_changed = true;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getHighPerfRetrieve(bool& high_perf_retrieve)
+{
+    DEB_MEMBER_FUNCT();
+    high_perf_retrieve = m_stream_config.highPerformanceRetrieveBuffer;
+    DEB_RETURN() << DEB_VAR1(high_perf_retrieve);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::setHighPerfRetrieve(bool high_perf_retrieve)
+{
+    DEB_MEMBER_FUNCT();
+    DEB_PARAM() << DEB_VAR1(high_perf_retrieve);
+
+    if (m_acq_started)
+        THROW_HW_ERROR(Error) << "Acquisition in progress";
+
+    m_stream_config.highPerformanceRetrieveBuffer = high_perf_retrieve;
+    m_stream_config_changed = true;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getArmedIdle(bool& armed_idle)
+{
+    DEB_MEMBER_FUNCT();
+    armed_idle = m_armed_idle;
+    DEB_RETURN() << DEB_VAR1(armed_idle);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::setArmedIdle(bool armed_idle)
+{
+    DEB_MEMBER_FUNCT();
+    DEB_PARAM() << DEB_VAR1(armed_idle);
+
+    if (m_acq_started)
+        THROW_HW_ERROR(Error) << "Acquisition in progress";
+
+    m_armed_idle = armed_idle;
+    if (!armed_idle)
+        _closeIdleStream();
+}
+
+//-----------------------------------------------------
+// the stream must be stopped to change the image format
+// or the driver configuration, the next startAcq reopens it
+//-----------------------------------------------------
+void Camera::_closeIdleStream()
+{
+    DEB_MEMBER_FUNCT();
+
+    AutoMutex lock(m_cond.mutex());
+    if (!m_stream_open || m_acq_started)
+        return;
+    m_stream_open = false;
+    lock.unlock();
+
+    DEB_TRACE() << "Close idle stream";
+    m_error = m_camera->StopCapture();
+    if (m_error != FlyCapture2::PGRERROR_OK)
+        THROW_HW_ERROR(Error) << "Unable to stop image capture: " << m_error.GetDescription();
+}
+
+//-----------------------------------------------------
+// written only when changed, then read back for what
+// the driver retained
+//-----------------------------------------------------
+void Camera::_applyStreamConfig()
+{
+    DEB_MEMBER_FUNCT();
+
+    // the retrieve is polled so that a stop never waits for
+    // a frame, the grab timeout is kept as set
+    FlyCapture2::FC2Config config = m_stream_config;
+    int grab_timeout = m_stream_config.grabTimeout;
+    if (grab_timeout < 0 || grab_timeout > RETRIEVE_POLL_TIMEOUT)
+        config.grabTimeout = RETRIEVE_POLL_TIMEOUT;
+
+    m_error = m_camera->SetConfiguration(&config);
+    if (m_error != FlyCapture2::PGRERROR_OK)
+        THROW_HW_ERROR(Error) << "Failed to set camera configuration: " << m_error.GetDescription();
+    m_stream_config_changed = false;
+
+    m_error = m_camera->GetConfiguration(&m_stream_config);
+    if (m_error != FlyCapture2::PGRERROR_OK)
+        THROW_HW_ERROR(Error) << "Failed to get camera configuration: " << m_error.GetDescription();
+    m_stream_config.grabTimeout = grab_timeout;
+}
+
+//-----------------------------------------------------
+// direct retrieve: the driver copies each frame out of its
+// own buffers into the Lima frame buffer, which spares the
+// dispatch thread copy. It is still one copy per frame, and
+// frames more than the Lima buffers ahead of the dispatch
+// go through the ring images
+//-----------------------------------------------------
+void Camera::getDirectRetrieve(bool& direct_retrieve)
+{
+    DEB_MEMBER_FUNCT();
+    direct_retrieve = m_direct_retrieve;
+    DEB_RETURN() << DEB_VAR1(direct_retrieve);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::setDirectRetrieve(bool direct_retrieve)
+{
+    DEB_MEMBER_FUNCT();
+    DEB_PARAM() << DEB_VAR1(direct_retrieve);
+
+    if (m_acq_started)
+        THROW_HW_ERROR(Error) << "Acquisition in progress";
+
+    m_direct_retrieve = direct_retrieve;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getRingSize(int& ring_size)
+{
+    DEB_MEMBER_FUNCT();
+    ring_size = m_ring_size;
+    DEB_RETURN() << DEB_VAR1(ring_size);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::setRingSize(int ring_size)
+{
+    DEB_MEMBER_FUNCT();
+    DEB_PARAM() << DEB_VAR1(ring_size);
+
+    if (ring_size < 1)
+        THROW_HW_ERROR(InvalidValue) << "Invalid " << DEB_VAR1(ring_size);
+    if (m_acq_started)
+        THROW_HW_ERROR(Error) << "Acquisition in progress";
+
+    // applied to the ring at the next prepareAcq
+    m_ring_size = ring_size;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getRingOccupancy(int& occupancy)
+{
+    DEB_MEMBER_FUNCT();
+    occupancy = m_ring->occupancy();
+    DEB_RETURN() << DEB_VAR1(occupancy);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getRingHighWater(int& high_water)
+{
+    DEB_MEMBER_FUNCT();
+    high_water = m_ring->highWater();
+    DEB_RETURN() << DEB_VAR1(high_water);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getHwTimestamp(bool& hw_timestamp)
+{
+    DEB_MEMBER_FUNCT();
+    hw_timestamp = m_hw_timestamp;
+    DEB_RETURN() << DEB_VAR1(hw_timestamp);
+}
+
+//-----------------------------------------------------
+// off by default: the embedded data overwrites the first
+// pixels of each frame
+//-----------------------------------------------------
+void Camera::setHwTimestamp(bool hw_timestamp)
+{
+    DEB_MEMBER_FUNCT();
+    DEB_PARAM() << DEB_VAR1(hw_timestamp);
+
+    if (m_acq_started)
+        THROW_HW_ERROR(Error) << "Acquisition in progress";
+
+    _setEmbeddedImageInfo(hw_timestamp);
+    if (hw_timestamp && !m_hw_timestamp)
+        THROW_HW_ERROR(Error) << "Camera has no embedded timestamp";
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getLastFrameCounter(int& frame_counter)
+{
+    DEB_MEMBER_FUNCT();
+    frame_counter = m_last_frame_counter;
+    DEB_RETURN() << DEB_VAR1(frame_counter);
+}
+
+//-----------------------------------------------------
+// acquisition thread placement
+//-----------------------------------------------------
+void Camera::getAcqCpus(std::string& cpus)
+{
+    DEB_MEMBER_FUNCT();
+    AutoMutex lock(m_cond.mutex());
+    cpus = m_acq_cpus;
+    DEB_RETURN() << DEB_VAR1(cpus);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::setAcqCpus(const std::string& cpus)
+{
+    DEB_MEMBER_FUNCT();
+    DEB_PARAM() << DEB_VAR1(cpus);
+
+    cpu_set_t cpu_set;
+    if (!_parseCpuList(cpus, cpu_set))
+        THROW_HW_ERROR(InvalidValue) << "Invalid cpu list " << DEB_VAR1(cpus);
+
+    AutoMutex lock(m_cond.mutex());
+    m_acq_cpus = cpus;
+    m_acq_sched_changed = true;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getAcqSchedPolicy(SchedPolicy& policy)
+{
+    DEB_MEMBER_FUNCT();
+    AutoMutex lock(m_cond.mutex());
+    policy = m_acq_policy;
+    DEB_RETURN() << DEB_VAR1(policy);
+}
+
+//-----------------------------------------------------
+// the priority is brought into the range of the new
+// policy when it is applied
+//-----------------------------------------------------
+void Camera::setAcqSchedPolicy(SchedPolicy policy)
+{
+    DEB_MEMBER_FUNCT();
+    DEB_PARAM() << DEB_VAR1(policy);
+
+    if (policy != SchedOther && policy != SchedFifo && policy != SchedRR)
+        THROW_HW_ERROR(InvalidValue) << "Invalid scheduling policy " << DEB_VAR1(policy);
+
+    AutoMutex lock(m_cond.mutex());
+    m_acq_policy = policy;
+    m_acq_sched_changed = true;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getAcqSchedPriority(int& priority)
+{
+    DEB_MEMBER_FUNCT();
+    AutoMutex lock(m_cond.mutex());
+    priority = m_acq_priority;
+    DEB_RETURN() << DEB_VAR1(priority);
+}
+
+//-----------------------------------------------------
+// -1 for the highest priority of the policy
+//-----------------------------------------------------
+void Camera::setAcqSchedPriority(int priority)
+{
+    DEB_MEMBER_FUNCT();
+    DEB_PARAM() << DEB_VAR1(priority);
+
+    AutoMutex lock(m_cond.mutex());
+    int policy = _posixSchedPolicy(m_acq_policy);
+    if (priority != -1 &&
+        (priority < sched_get_priority_min(policy) || priority > sched_get_priority_max(policy)))
+        THROW_HW_ERROR(InvalidValue) << "Invalid priority for the scheduling policy "
+                                     << DEB_VAR2(priority, m_acq_policy);
+
+    m_acq_priority = priority;
+    m_acq_sched_changed = true;
+}
+
+//-----------------------------------------------------
+// read back from the thread, settings changed since are
+// applied at the next acquisition start
+//-----------------------------------------------------
+void Camera::getAppliedAcqCpus(std::string& cpus)
+{
+    DEB_MEMBER_FUNCT();
+    AutoMutex lock(m_cond.mutex());
+    cpus = m_applied_acq_cpus;
+    DEB_RETURN() << DEB_VAR1(cpus);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getAppliedAcqSched(SchedPolicy& policy, int& priority)
+{
+    DEB_MEMBER_FUNCT();
+    AutoMutex lock(m_cond.mutex());
+    policy = m_applied_acq_policy;
+    priority = m_applied_acq_priority;
+    DEB_RETURN() << DEB_VAR2(policy, priority);
+}
+
+//-----------------------------------------------------
+// average over the running or last acquisition, MB/s
+//-----------------------------------------------------
+void Camera::getAcqBandwidth(double& bandwidth)
+{
+    DEB_MEMBER_FUNCT();
+    double elapsed = m_last_frame_time - m_start_timestamp;
+    bandwidth = (elapsed > 0) ? m_acq_bytes / elapsed / 1E6 : 0;
+    DEB_RETURN() << DEB_VAR1(bandwidth);
+}
+
+//-----------------------------------------------------
+// colour cameras
+//-----------------------------------------------------
+void Camera::getBayerMode(BayerMode& mode)
+{
+    DEB_MEMBER_FUNCT();
+    mode = m_bayer_mode;
+    DEB_RETURN() << DEB_VAR1(mode);
+}
+
+//-----------------------------------------------------
+// Applies to the Bpp8 and Bpp16 image types, Bpp24 is always
+// demosaiced to RGB
+//-----------------------------------------------------
+void Camera::setBayerMode(BayerMode mode)
+{
+    DEB_MEMBER_FUNCT();
+    DEB_PARAM() << DEB_VAR1(mode);
+
+    if (mode != BayerOff && !m_camera_info.isColorCamera)
+        THROW_HW_ERROR(Error) << "Bayer modes need a colour camera";
+
+    ImageType type;
+    getImageType(type);
+
+    BayerMode old_mode = m_bayer_mode;
+    m_bayer_mode = mode;
+    try
+    {
+        setImageType(type);
+    }
+    catch (Exception &e)
+    {
+        m_bayer_mode = old_mode;
+        throw;
+    }
+}
+
+//-----------------------------------------------------
+// frame accumulation
+//-----------------------------------------------------
+void Camera::getAccNbFrames(int& nb_frames)
+{
+    DEB_MEMBER_FUNCT();
+    nb_frames = m_acc_nb_frames;
+    DEB_RETURN() << DEB_VAR1(nb_frames);
+}
+
+//-----------------------------------------------------
+// 16 bit pixels can't wrap a 32 bit sum of ACC_MAX_FRAMES.
+// IntTrigMult fires one trigger per Lima frame, it is not
+// accumulated
+//-----------------------------------------------------
+void Camera::setAccNbFrames(int nb_frames)
+{
+    DEB_MEMBER_FUNCT();
+    DEB_PARAM() << DEB_VAR1(nb_frames);
+
+    if (m_acq_started)
+        THROW_HW_ERROR(Error) << "Acquisition in progress";
+    if (nb_frames < 1 || nb_frames > ACC_MAX_FRAMES)
+        THROW_HW_ERROR(InvalidValue) << "Invalid number of accumulated frames " << DEB_VAR1(nb_frames);
+    if (nb_frames == m_acc_nb_frames)
+        return;
+
+    if (nb_frames > 1)
+    {
+        if (m_bayer_rgb)
+            THROW_HW_ERROR(NotSupported) << "RGB frames can't be accumulated";
+        int trig_mode = m_staged.has_trig_mode ? int(m_staged.trig_mode) : m_applied_trig_mode;
+        if (trig_mode == IntTrigMult)
+            THROW_HW_ERROR(NotSupported) << "Frames can't be accumulated in IntTrigMult";
+    }
+
+    ImageType old_type, type;
+    getImageType(old_type);
+    m_acc_nb_frames = nb_frames;
+    getImageType(type);
+    if (type != old_type)
+    {
+        Size max_size;
+        getDetectorImageSize(max_size);
+        maxImageSizeChanged(max_size, type);
+    }
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getAccSaturation(int& last_saturated, int& saturated_frames)
+{
+    DEB_MEMBER_FUNCT();
+    last_saturated = m_acc_last_saturated;
+    saturated_frames = m_acc_saturated_frames;
+    DEB_RETURN() << DEB_VAR2(last_saturated, saturated_frames);
+}
+
+//-----------------------------------------------------
+// the driver data can land unchanged in the Lima buffer
+//-----------------------------------------------------
+bool Camera::_isDirectFormat()
+{
+    if (m_acc_nb_frames > 1)
+        // summed up by the dispatch thread
+        return false;
+    switch (m_image_settings.pixelFormat)
+    {
+    case FlyCapture2::PIXEL_FORMAT_MONO12:
+        return false;
+    case FlyCapture2::PIXEL_FORMAT_RAW8:
+    case FlyCapture2::PIXEL_FORMAT_RAW16:
+        return !m_bayer_rgb && m_bayer_mode != BayerLuminance;
+    default:
+        return true;
+    }
+}
+
+//-----------------------------------------------------
+// frame path timing
+//-----------------------------------------------------
+void Camera::getLatencyStats(bool& enabled)
+{
+    DEB_MEMBER_FUNCT();
+    enabled = m_latency_stats;
+    DEB_RETURN() << DEB_VAR1(enabled);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::setLatencyStats(bool enabled)
+{
+    DEB_MEMBER_FUNCT();
+    DEB_PARAM() << DEB_VAR1(enabled);
+    m_latency_stats = enabled;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::resetLatencyStats()
+{
+    DEB_MEMBER_FUNCT();
+
+    // the histograms are only written by the running threads
+    if (m_acq_started)
+        THROW_HW_ERROR(Error) << "Acquisition in progress";
+
+    for (int i = 0; i < NbLatencyStages; ++i)
+        m_latency[i].reset();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getLatencySummary(LatencyStage stage, int& count, double& min_time,
+                               double& p50_time, double& p99_time, double& max_time)
+{
+    DEB_MEMBER_FUNCT();
+    DEB_PARAM() << DEB_VAR1(stage);
+
+    if (stage < 0 || stage >= NbLatencyStages)
+        THROW_HW_ERROR(InvalidValue) << "Invalid latency stage " << stage;
+
+    m_latency[stage].getSummary(count, min_time, p50_time, p99_time, max_time);
+    DEB_RETURN() << DEB_VAR5(count, min_time, p50_time, p99_time, max_time);
+}
+
+//-----------------------------------------------------
+// seconds, -1 until a software triggered frame came in
+//-----------------------------------------------------
+void Camera::getLastTriggerLatency(double& latency)
+{
+    DEB_MEMBER_FUNCT();
+    latency = m_trigger_latency;
+    DEB_RETURN() << DEB_VAR1(latency);
+}
+
+//-----------------------------------------------------
+// seconds, -1 until the first stop
+//-----------------------------------------------------
+void Camera::getLastStopLatency(double& latency)
+{
+    DEB_MEMBER_FUNCT();
+    latency = m_stop_latency;
+    DEB_RETURN() << DEB_VAR1(latency);
+}
+
+//-----------------------------------------------------
+// lost frames
+//-----------------------------------------------------
+void Camera::getDropPolicy(DropPolicy& policy)
+{
+    DEB_MEMBER_FUNCT();
+    policy = m_drop_policy;
+    DEB_RETURN() << DEB_VAR1(policy);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::setDropPolicy(DropPolicy policy)
+{
+    DEB_MEMBER_FUNCT();
+    DEB_PARAM() << DEB_VAR1(policy);
+
+    if (m_acq_started)
+        THROW_HW_ERROR(Error) << "Acquisition in progress";
+    if (policy == DropPlaceholder && !m_hw_frame_counter)
+        DEB_WARNING() << "No camera frame counter (see setHwTimestamp), only inconsistent "
+                         "frames get a placeholder";
+
+    m_drop_policy = policy;
+}
+
+//-----------------------------------------------------
+// frames missing from the camera frame counter sequence
+//-----------------------------------------------------
+void Camera::getDroppedFrames(int& dropped_frames)
+{
+    DEB_MEMBER_FUNCT();
+    dropped_frames = m_dropped_frames;
+    DEB_RETURN() << DEB_VAR1(dropped_frames);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getInconsistentFrames(int& inconsistent_frames)
+{
+    DEB_MEMBER_FUNCT();
+    inconsistent_frames = m_inconsistent_frames;
+    DEB_RETURN() << DEB_VAR1(inconsistent_frames);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getResentPackets(int& resent_packets)
+{
+    DEB_MEMBER_FUNCT();
+
+    if (!m_start_stats_valid)
+        THROW_HW_ERROR(Error) << "No camera statistics";
+
+    FlyCapture2::CameraStats stats;
+    m_error = m_camera->GetStats(&stats);
+    if (m_error != FlyCapture2::PGRERROR_OK)
+        THROW_HW_ERROR(Error) << "Unable to get camera statistics: " << m_error.GetDescription();
+
+    resent_packets = stats.numResendPacketsReceived - m_start_stats.numResendPacketsReceived;
+    DEB_RETURN() << DEB_VAR1(resent_packets);
+}
+
+//-----------------------------------------------------
+// differences between the start of the acquisition and
+// the last poll, no driver access
+//-----------------------------------------------------
+void Camera::getStreamStats(int& images_dropped, int& images_driver_dropped,
+                            int& images_corrupt, int& transmit_failures,
+                            int& resend_requested, int& resend_received)
+{
+    DEB_MEMBER_FUNCT();
+    AutoMutex lock(m_stats_lock);
+    if (!m_start_stats_valid || !m_polled_stats_valid)
+        THROW_HW_ERROR(Error) << "No camera statistics";
+
+    const FlyCapture2::CameraStats& start = m_start_stats;
+    const FlyCapture2::CameraStats& last = m_polled_stats;
+    images_dropped = last.imageDropped - start.imageDropped;
+    images_driver_dropped = last.imageDriverDropped - start.imageDriverDropped;
+    images_corrupt = last.imageCorrupt - start.imageCorrupt;
+    transmit_failures = last.imageXmitFailed - start.imageXmitFailed;
+    resend_requested = last.numResendPacketsRequested - start.numResendPacketsRequested;
+    resend_received = last.numResendPacketsReceived - start.numResendPacketsReceived;
+    DEB_RETURN() << DEB_VAR3(images_dropped, images_driver_dropped, images_corrupt);
+    DEB_RETURN() << DEB_VAR3(transmit_failures, resend_requested, resend_received);
+}
+
+//-----------------------------------------------------
+// the driver reports tenths of kelvin
+//-----------------------------------------------------
+void Camera::getTemperature(double& temperature)
+{
+    DEB_MEMBER_FUNCT();
+    AutoMutex lock(m_stats_lock);
+    if (!m_polled_stats_valid || !m_polled_stats.temperature)
+        THROW_HW_ERROR(Error) << "No camera temperature";
+
+    temperature = m_polled_stats.temperature / 10. - 273.15;
+    DEB_RETURN() << DEB_VAR1(temperature);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::_pollStats()
+{
+    DEB_MEMBER_FUNCT();
+    FlyCapture2::CameraStats stats;
+    BackendError error = m_camera->GetStats(&stats);
+    if (error != FlyCapture2::PGRERROR_OK)
+    {
+        DEB_WARNING() << "Unable to get camera statistics: " << error.GetDescription();
+        return;
+    }
+
+    AutoMutex lock(m_stats_lock);
+    m_polled_stats = stats;
+    m_polled_stats_valid = true;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::_setEmbeddedImageInfo(bool enable)
+{
+    DEB_MEMBER_FUNCT();
+    DEB_PARAM() << DEB_VAR1(enable);
+
+    FlyCapture2::EmbeddedImageInfo info;
+    m_error = m_camera->GetEmbeddedImageInfo(&info);
+    if (m_error != FlyCapture2::PGRERROR_OK)
+        THROW_HW_ERROR(Error) << "Unable to get embedded image info: " << m_error.GetDescription();
+
+    info.timestamp.onOff = enable && info.timestamp.available;
+    info.frameCounter.onOff = enable && info.frameCounter.available;
+
+    m_error = m_camera->SetEmbeddedImageInfo(&info);
+    if (m_error != FlyCapture2::PGRERROR_OK)
+        THROW_HW_ERROR(Error) << "Unable to set embedded image info: " << m_error.GetDescription();
+
+    m_hw_timestamp = info.timestamp.onOff;
+    m_hw_frame_counter = info.frameCounter.onOff;
+}
+
+//-----------------------------------------------------
+// The embedded timestamp is the 1394 cycle time, wrapping
+// every 128 s. The host clock tells how many wraps happened
+// between two frames, so long trigger gaps stay correct.
+//-----------------------------------------------------
+double Camera::_hwTimestamp(const FlyCapture2::TimeStamp& timestamp, double host_time, bool first)
+{
+    double cycle = timestamp.cycleSeconds + timestamp.cycleCount / 8000. +
+                   timestamp.cycleOffset / (8000. * 3072.);
+    if (first)
+    {
+        m_hw_clock_origin = host_time;
+        m_hw_clock_elapsed = 0;
+    }
+    else
+    {
+        double delta = cycle - m_hw_clock_last_cycle;
+        if (delta < 0)
+            delta += 128.;
+        double host_delta = host_time - m_hw_clock_last_host;
+        delta += 128. * floor((host_delta - delta) / 128. + 0.5);
+        m_hw_clock_elapsed += delta;
+    }
+    m_hw_clock_last_cycle = cycle;
+    m_hw_clock_last_host = host_time;
+    return m_hw_clock_origin + m_hw_clock_elapsed;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::prepareAcq()
+{
+    DEB_MEMBER_FUNCT();
+
+    // Wait for the previous acquisition to be fully dispatched
+    AutoMutex lock(m_cond.mutex());
+    while (m_thread_running)
+        m_cond.wait();
+    lock.unlock();
+
+    _commitConfig();
+    // the multi-shot burst length follows the number of frames
+    if (m_applied_trig_mode == ExtTrigSingle)
+        _applyTrigMode(ExtTrigSingle);
+
+    // The dispatch thread polls the ring even between acquisitions,
+    // it is parked while the slots are replaced
+    lock.lock();
+    m_dispatch_park = true;
+    lock.unlock();
+    m_ring->wakeup();
+    lock.lock();
+    while (!m_dispatch_idle)
+        m_cond.wait();
+    lock.unlock();
+
+    m_ring->reset(m_ring_size);
+
+    lock.lock();
+    m_dispatch_park = false;
+    m_cond.broadcast();
+    lock.unlock();
+
+    m_image_number = 0;
+    m_dispatched_frames = 0;
+    m_dropped_frames = 0;
+    m_acc_last_saturated = 0;
+    m_acc_saturated_frames = 0;
+    m_inconsistent_frames = 0;
+    for (int i = 0; i < NbLatencyStages; ++i)
+        m_latency[i].reset();
+}
+
+//-----------------------------------------------------
+// deferred configuration
+//-----------------------------------------------------
+void Camera::getDeferredConfig(bool& deferred)
+{
+    DEB_MEMBER_FUNCT();
+    deferred = m_deferred_config;
+    DEB_RETURN() << DEB_VAR1(deferred);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::setDeferredConfig(bool deferred)
+{
+    DEB_MEMBER_FUNCT();
+    DEB_PARAM() << DEB_VAR1(deferred);
+
+    if (m_acq_started)
+        THROW_HW_ERROR(Error) << "Acquisition in progress";
+
+    m_deferred_config = deferred;
+    if (!deferred)
+        // nothing may stay pending
+        _commitConfig();
+}
+
+//-----------------------------------------------------
+// Write the staged settings in dependency order: image format,
+// trigger, frame rate, then exposure (bounded by the frame
+// period) and gain. Values already in the camera are skipped.
+//-----------------------------------------------------
+void Camera::_commitConfig()
+{
+    DEB_MEMBER_FUNCT();
+
+    if (m_staged.has_image_settings)
+    {
+        _applyImageSettings();
+        m_staged.has_image_settings = false;
+    }
+
+    if (m_staged.has_trig_mode)
+    {
+        if (m_staged.trig_mode != m_applied_trig_mode)
+            _applyTrigMode(m_staged.trig_mode);
+        m_staged.has_trig_mode = false;
+    }
+
+    if (m_staged.has_auto_frame_rate)
+    {
+        _commitPropertyAutoMode(FlyCapture2::FRAME_RATE, m_staged.auto_frame_rate);
+        m_staged.has_auto_frame_rate = false;
+    }
+    if (m_staged.has_frame_rate)
+    {
+        _commitPropertyValue(FlyCapture2::FRAME_RATE, m_staged.frame_rate);
+        m_staged.has_frame_rate = false;
+    }
+
+    if (m_staged.has_exp_time)
+    {
+        _commitPropertyValue(FlyCapture2::SHUTTER, m_staged.exp_time);
+        m_staged.has_exp_time = false;
+    }
+
+    if (m_staged.has_gain)
+    {
+        _commitPropertyValue(FlyCapture2::GAIN, m_staged.gain);
+        m_staged.has_gain = false;
+    }
 }
 
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
-void Camera::getPacketDelay(int& packet_delay)
+void Camera::_commitPropertyValue(FlyCapture2::PropertyType type, double value)
 {
     DEB_MEMBER_FUNCT();
-#ifdef USE_GIGE
-    FlyCapture2::GigEProperty property;
-    property.propType = FlyCapture2::PACKET_DELAY;
+    FlyCapture2::Property property(type);
 
-    m_error = m_camera->GetGigEProperty(&property);
-    if (m_error != FlyCapture2::PGRERROR_OK)
-        THROW_HW_ERROR(Error) << "Failed to get PACKET_DELAY property: " << m_error.GetDescription();
+    _getProperty(type, property);
+    if (property.onOff && !property.autoManualMode &&
+        fabs(property.absValue - value) <= 1E-6 * fabs(value))
+        return;
 
-    packet_delay = property.value;
-    DEB_RETURN() << DEB_VAR1(packet_delay);
-#endif
+    _setPropertyValue(type, value);
 }
 
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
-void Camera::setPacketDelay(int packet_delay)
+void Camera::_commitPropertyAutoMode(FlyCapture2::PropertyType type, bool auto_mode)
 {
     DEB_MEMBER_FUNCT();
-    DEB_PARAM() << DEB_VAR1(packet_delay);
-#ifdef USE_GIGE
-    FlyCapture2::GigEProperty property;
-    property.propType = FlyCapture2::PACKET_DELAY;
-    property.value = packet_delay;
+    FlyCapture2::Property property(type);
 
-    m_error = m_camera->SetGigEProperty(&property);
-    if (m_error != FlyCapture2::PGRERROR_OK)
-        THROW_HW_ERROR(Error) << "Failed to set PACKET_DELAY property: " << m_error.GetDescription();
-#endif
-}
+    _getProperty(type, property);
+    if (property.autoManualMode == auto_mode)
+        return;
 
-//-----------------------------------------------------
-//
-//-----------------------------------------------------
-void Camera::prepareAcq()
-{
-    DEB_MEMBER_FUNCT();
-    m_image_number = 0;
+    _setPropertyAutoMode(type, auto_mode);
 }
 
 //-----------------------------------------------------
@@ -231,38 +2008,188 @@ void Camera::startAcq()
 {
     DEB_MEMBER_FUNCT();
 
+    // IntTrigMult keeps the stream running, one trigger per frame
+    if (m_applied_trig_mode == IntTrigMult)
+    {
+        AutoMutex lock(m_cond.mutex());
+        bool started = m_acq_started;
+        lock.unlock();
+        if (started)
+        {
+            DEB_TRACE() << "Trigger image# " << m_image_number;
+            _setStatus(Camera::Exposure, false);
+            // the grab timeout runs from the trigger, not from
+            // the previous frame
+            m_last_frame_time = Timestamp::now();
+            _fireSoftwareTrigger();
+            return;
+        }
+    }
+
     DEB_TRACE() << "Start acquisition";
 
     StdBufferCbMgr& buffer_mgr = m_buffer_ctrl_obj.getBuffer();
-    buffer_mgr.setStartTimestamp(Timestamp::now());
+    m_start_timestamp = Timestamp::now();
+    buffer_mgr.setStartTimestamp(m_start_timestamp);
 
-    m_error = m_camera->StartCapture();
-    if (m_error != FlyCapture2::PGRERROR_OK)
-        THROW_HW_ERROR(Error) << "Unable to start image capture: " << m_error.GetDescription();
+    if (m_stream_config_changed)
+    {
+        _closeIdleStream();
+        _applyStreamConfig();
+    }
+
+    if (m_stream_open)
+    {
+        // armed idle: the statistics polled when the previous
+        // acquisition stopped are the reference of this one
+        AutoMutex stats_lock(m_stats_lock);
+        m_start_stats = m_polled_stats;
+        m_start_stats_valid = m_polled_stats_valid;
+    }
+    else
+    {
+        // reference for the statistics of this acquisition
+        FlyCapture2::CameraStats start_stats;
+        m_error = m_camera->GetStats(&start_stats);
+        {
+            AutoMutex stats_lock(m_stats_lock);
+            m_start_stats = start_stats;
+            m_start_stats_valid = (m_error == FlyCapture2::PGRERROR_OK);
+            m_polled_stats = start_stats;
+            m_polled_stats_valid = m_start_stats_valid;
+        }
+        if (!m_start_stats_valid)
+            DEB_WARNING() << "Unable to get camera statistics: " << m_error.GetDescription();
+
+        m_error = m_camera->StartCapture();
+        if (m_error != FlyCapture2::PGRERROR_OK)
+            THROW_HW_ERROR(Error) << "Unable to start image capture: " << m_error.GetDescription();
+    }
 
-    // Start acquisition thread
+    // Open the frame gate of the acquisition thread
     AutoMutex lock(m_cond.mutex());
+    m_stream_open = true;
+    m_acq_bytes = 0;
+    m_last_frame_time = m_start_timestamp;
+    m_tune_time = m_start_timestamp;
+    m_tune_bytes = 0;
+    m_tune_resends = m_start_stats.numResendPacketsRequested;
+    m_tune_dropped = m_start_stats.imageDropped;
+    m_tune_clean = 0;
+    m_dispatch_continue = true;
     m_acq_started = true;
     m_cond.broadcast();
+    lock.unlock();
+
+    if (m_applied_trig_mode == IntTrigMult)
+        _fireSoftwareTrigger();
+}
+
+//-----------------------------------------------------
+// wait for the camera to be ready for a trigger, one not
+// reporting it is triggered straight away
+//-----------------------------------------------------
+void Camera::_fireSoftwareTrigger()
+{
+    DEB_MEMBER_FUNCT();
+
+    double deadline = LatencyHistogram::now() + SOFTWARE_TRIGGER_READY_TIMEOUT;
+    while (true)
+    {
+        unsigned int value = 0;
+        m_error = m_camera->ReadRegister(SOFTWARE_TRIGGER_REG, &value);
+        if (m_error != FlyCapture2::PGRERROR_OK)
+        {
+            DEB_TRACE() << "No trigger ready status: " << m_error.GetDescription();
+            break;
+        }
+        if (!(value >> 31))
+            break;
+        if (LatencyHistogram::now() > deadline)
+            THROW_HW_ERROR(Error) << "Camera not ready for a software trigger";
+    }
+
+    m_trigger_time = LatencyHistogram::now();
+    m_error = m_camera->FireSoftwareTrigger();
+    if (m_error != FlyCapture2::PGRERROR_OK)
+        THROW_HW_ERROR(Error) << "Unable to fire software trigger: " << m_error.GetDescription();
 }
 
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
 void Camera::stopAcq()
+{
+    _stopAcq(false);
+}
+
+//-----------------------------------------------------
+// internalFlag: stopped by the acquisition thread after the
+// last frame, the stream then stays open when armed idle.
+// Otherwise the acquisition thread is waited for, it leaves
+// the driver within RETRIEVE_POLL_TIMEOUT as the retrieve is
+// polled, and the wait is bounded by STOP_TIMEOUT anyway
+//-----------------------------------------------------
+void Camera::_stopAcq(bool internalFlag)
 {
     DEB_MEMBER_FUNCT();
+    DEB_PARAM() << DEB_VAR1(internalFlag);
+
+    // stopped once, by whoever comes first
     AutoMutex lock(m_cond.mutex());
     if (!m_acq_started)
         return;
+    double t0 = LatencyHistogram::now();
     m_acq_started = false;
+    bool keep_stream = internalFlag && m_armed_idle;
+    if (!keep_stream)
+        m_stream_open = false;
+    m_cond.broadcast();
     lock.unlock();
 
-    DEB_TRACE() << "Stop acquisition";
-    m_error = m_camera->StopCapture();
-    if (m_error != FlyCapture2::PGRERROR_OK)
-        THROW_HW_ERROR(Error) << "Unable to stop image capture: " << m_error.GetDescription();
+    // not m_error, the acquisition thread may be the caller
+    BackendError error;
+    if (keep_stream)
+        DEB_TRACE() << "Stop acquisition, stream left open";
+    else
+    {
+        DEB_TRACE() << "Stop acquisition";
+        error = m_camera->StopCapture();
+    }
+
+    if (!internalFlag)
+    {
+        double deadline = t0 + STOP_TIMEOUT;
+        lock.lock();
+        while (m_retrieving)
+        {
+            double left = deadline - LatencyHistogram::now();
+            if (left <= 0)
+                break;
+            m_cond.wait(left);
+        }
+        bool retrieving = m_retrieving;
+        lock.unlock();
+        if (retrieving)
+            DEB_WARNING() << "Acquisition thread still retrieving after " << STOP_TIMEOUT << " s";
+    }
+    m_stop_latency = LatencyHistogram::now() - t0;
+    DEB_TRACE() << "Stopped in " << m_stop_latency << " s";
 
+    // end of acquisition statistics
+    _pollStats();
+
+    if (error != FlyCapture2::PGRERROR_OK)
+    {
+        _setStatus(Camera::Fault, false);
+        // nothing would catch it in the acquisition thread
+        if (internalFlag)
+        {
+            DEB_ERROR() << "Unable to stop image capture: " << error.GetDescription();
+            return;
+        }
+        THROW_HW_ERROR(Error) << "Unable to stop image capture: " << error.GetDescription();
+    }
     _setStatus(Camera::Ready, false);
 }
 
@@ -272,7 +2199,9 @@ void Camera::stopAcq()
 void Camera::getDetectorImageSize(Size& size)
 {
     DEB_MEMBER_FUNCT();
-    size = Size(m_image_settings_info.maxWidth, m_image_settings_info.maxHeight);
+    // the image settings info is given for the current binning
+    size = Size(m_image_settings_info.maxWidth * m_bin.getX(),
+                m_image_settings_info.maxHeight * m_bin.getY());
     DEB_RETURN() << DEB_VAR1(size);
 }
 
@@ -300,6 +2229,19 @@ void Camera::getDetectorModel(string& model)
 //
 //-----------------------------------------------------
 void Camera::getImageType(ImageType& type)
+{
+    DEB_MEMBER_FUNCT();
+    if (m_acc_nb_frames > 1)
+        type = Bpp32;
+    else
+        _getCameraImageType(type);
+    DEB_RETURN() << DEB_VAR1(type);
+}
+
+//-----------------------------------------------------
+// what the camera delivers, before any accumulation
+//-----------------------------------------------------
+void Camera::_getCameraImageType(ImageType& type)
 {
     DEB_MEMBER_FUNCT();
     switch (m_image_settings.pixelFormat)
@@ -307,9 +2249,16 @@ void Camera::getImageType(ImageType& type)
     case FlyCapture2::PIXEL_FORMAT_MONO8:
         type = Bpp8;
         break;
+    case FlyCapture2::PIXEL_FORMAT_MONO12:
+        type = Bpp12;
+        break;
     case FlyCapture2::PIXEL_FORMAT_MONO16:
+    case FlyCapture2::PIXEL_FORMAT_RAW16:
         type = Bpp16;
         break;
+    case FlyCapture2::PIXEL_FORMAT_RAW8:
+        type = m_bayer_rgb ? Bpp24 : Bpp8;
+        break;
     default:
         THROW_HW_ERROR(Error) << "Unable to determine the image type";
     }
@@ -328,20 +2277,45 @@ void Camera::setImageType(ImageType type)
     bool valid;
 
     old_format = m_image_settings.pixelFormat;
+    bool old_rgb = m_bayer_rgb, new_rgb = false;
+    bool bayer = (m_bayer_mode != BayerOff);
 
-    switch (type)
+    // Accumulated frames are Bpp32 whatever the camera depth,
+    // which is chosen before accumulating
+    ImageType camera_type = type;
+    if (m_acc_nb_frames > 1)
+    {
+        if (type != Bpp32)
+            THROW_HW_ERROR(Error) << "Frames are accumulated, the image type is Bpp32";
+        _getCameraImageType(camera_type);
+    }
+
+    // Colour cameras keep the Bayer mosaic on the link, a third
+    // of the on-board RGB bandwidth
+    switch (camera_type)
     {
     case Bpp8:
-        new_format = FlyCapture2::PIXEL_FORMAT_MONO8;
+        new_format = bayer ? FlyCapture2::PIXEL_FORMAT_RAW8 : FlyCapture2::PIXEL_FORMAT_MONO8;
+        break;
+    case Bpp12:
+        // packed on the link, unpacked by the dispatch thread
+        new_format = FlyCapture2::PIXEL_FORMAT_MONO12;
         break;
     case Bpp16:
-        new_format = FlyCapture2::PIXEL_FORMAT_MONO16;
+        new_format = bayer ? FlyCapture2::PIXEL_FORMAT_RAW16 : FlyCapture2::PIXEL_FORMAT_MONO16;
+        break;
+    case Bpp24:
+        // R G B bytes, demosaiced by the dispatch thread
+        if (!m_camera_info.isColorCamera)
+            THROW_HW_ERROR(Error) << "RGB needs a colour camera";
+        new_format = FlyCapture2::PIXEL_FORMAT_RAW8;
+        new_rgb = true;
         break;
     default:
         THROW_HW_ERROR(Error) << "Unsupported image type";
     }
 
-    if (new_format == old_format)
+    if (new_format == old_format && new_rgb == old_rgb)
         // nothing to do
         return;
 
@@ -349,17 +2323,59 @@ void Camera::setImageType(ImageType type)
         THROW_HW_ERROR(Error) << "Acquisition in progress";
 
     m_image_settings.pixelFormat = new_format;
-    try
+    m_bayer_rgb = new_rgb;
+    if (m_deferred_config)
+        m_staged.has_image_settings = true;
+    else if (new_format != old_format)
     {
-        _applyImageSettings();
+        try
+        {
+            _applyImageSettings();
+        }
+        catch (Exception &e)
+        {
+            m_image_settings.pixelFormat = old_format;
+            m_bayer_rgb = old_rgb;
+            THROW_HW_ERROR(Error) << e.getErrDesc();
+        }
     }
-    catch (Exception &e)
+
+    Size max_size;
+    getDetectorImageSize(max_size);
+    maxImageSizeChanged(max_size, type);
+}
+
+//-----------------------------------------------------
+// From the camera trigger inquiry, mode n is bit (15 - n)
+// of the mask
+//-----------------------------------------------------
+void Camera::checkTrigMode(TrigMode mode, bool& valid)
+{
+    DEB_MEMBER_FUNCT();
+    DEB_PARAM() << DEB_VAR1(mode);
+
+    _getTriggerModeInfo();
+    const FlyCapture2::TriggerModeInfo& info = m_trigger_mode_info;
+    switch (mode)
     {
-        m_image_settings.pixelFormat = old_format;
-        THROW_HW_ERROR(Error) << e.getErrDesc();
+    case IntTrig:
+        valid = true;
+        break;
+    case IntTrigMult:
+        valid = m_acc_nb_frames == 1 && info.present && info.softwareTriggerSupported &&
+                (info.modeMask & (1 << (15 - TRIGGER_MODE_EDGE)));
+        break;
+    case ExtTrigSingle:
+    case ExtTrigMult:
+        valid = info.present && (info.modeMask & (1 << (15 - TRIGGER_MODE_EDGE)));
+        break;
+    case ExtGate:
+        valid = info.present && (info.modeMask & (1 << (15 - TRIGGER_MODE_BULB)));
+        break;
+    default:
+        valid = false;
     }
-
-    maxImageSizeChanged(Size(m_image_settings_info.maxWidth, m_image_settings_info.maxHeight), type);
+    DEB_RETURN() << DEB_VAR1(valid);
 }
 
 //-----------------------------------------------------
@@ -369,7 +2385,12 @@ void Camera::getTrigMode(TrigMode& mode)
 {
     DEB_MEMBER_FUNCT();
 
-    cout << "getTrigMode" << endl;
+    if (m_staged.has_trig_mode)
+    {
+        mode = m_staged.trig_mode;
+        DEB_RETURN() << DEB_VAR1(mode);
+        return;
+    }
 
     // Get current trigger settings
     FlyCapture2::TriggerMode triggerMode;
@@ -377,7 +2398,16 @@ void Camera::getTrigMode(TrigMode& mode)
     if (m_error != FlyCapture2::PGRERROR_OK)
         THROW_HW_ERROR(Error) << "Unable to get trigger mode settings: " << m_error.GetDescription();
 
-    mode = triggerMode.onOff ? ExtTrigSingle : IntTrig;
+    if (!triggerMode.onOff)
+        mode = IntTrig;
+    else if (triggerMode.source == TRIGGER_SOURCE_SOFTWARE)
+        mode = IntTrigMult;
+    else if (triggerMode.mode == TRIGGER_MODE_BULB)
+        mode = ExtGate;
+    else if (triggerMode.mode == TRIGGER_MODE_EDGE && m_applied_trig_mode == ExtTrigMult)
+        mode = ExtTrigMult;
+    else
+        mode = ExtTrigSingle;
 
     DEB_RETURN() << DEB_VAR1(mode);
 }
@@ -390,15 +2420,56 @@ void Camera::setTrigMode(TrigMode mode)
     DEB_MEMBER_FUNCT();
     DEB_PARAM() << DEB_VAR1(mode);
 
-    // Check for external trigger support
-    FlyCapture2::TriggerModeInfo triggerModeInfo;
-    m_error = m_camera->GetTriggerModeInfo(&triggerModeInfo);
+    bool valid;
+    checkTrigMode(mode, valid);
+    if (!valid)
+        THROW_HW_ERROR(Error) << "Trigger mode " << mode << " is not supported";
+
+    if (m_deferred_config)
+    {
+        m_staged.has_trig_mode = true;
+        m_staged.trig_mode = mode;
+        return;
+    }
+    _applyTrigMode(mode);
+}
+
+//-----------------------------------------------------
+// the trigger capabilities do not change, read them once
+//-----------------------------------------------------
+void Camera::_getTriggerModeInfo()
+{
+    DEB_MEMBER_FUNCT();
+    if (m_trigger_mode_info_valid)
+        return;
+
+    m_error = m_camera->GetTriggerModeInfo(&m_trigger_mode_info);
     if (m_error != FlyCapture2::PGRERROR_OK)
         THROW_HW_ERROR(Error) << "Unable to get trigger mode info from camera: " << m_error.GetDescription();
+    m_trigger_mode_info_valid = true;
+}
+
+//-----------------------------------------------------
+// ExtTrigSingle runs the whole sequence from one edge with
+// the camera multi-shot mode when it has it, else one frame
+// is taken per edge like ExtTrigMult. IntTrigMult takes one
+// frame per software trigger. The camera is only written when
+// its trigger settings change.
+//-----------------------------------------------------
+void Camera::_applyTrigMode(TrigMode mode)
+{
+    DEB_MEMBER_FUNCT();
+    DEB_PARAM() << DEB_VAR1(mode);
 
-    if (!triggerModeInfo.present)
+    _getTriggerModeInfo();
+    const FlyCapture2::TriggerModeInfo& info = m_trigger_mode_info;
+    if (!info.present)
     {
-        DEB_ERROR() << "Camera does not support external trigger";
+        // free running is all such a camera does
+        if (mode == IntTrig)
+            m_applied_trig_mode = mode;
+        else
+            DEB_ERROR() << "Camera does not support external trigger";
         return;
     }
 
@@ -407,7 +2478,12 @@ void Camera::setTrigMode(TrigMode mode)
     m_error = m_camera->GetTriggerMode(&triggerMode);
     if (m_error != FlyCapture2::PGRERROR_OK)
         THROW_HW_ERROR(Error) << "Unable to get trigger mode settings: " << m_error.GetDescription();
+    FlyCapture2::TriggerMode current = triggerMode;
 
+    // camera frames, accumulated ones included
+    int nb_frames = m_nb_frames * m_acc_nb_frames;
+    bool multi_shot = (info.modeMask & (1 << (15 - TRIGGER_MODE_MULTI_SHOT))) &&
+                      nb_frames > 1 && nb_frames <= MULTI_SHOT_MAX_FRAMES;
     switch (mode)
     {
     case IntTrig:
@@ -415,16 +2491,42 @@ void Camera::setTrigMode(TrigMode mode)
         break;
     case ExtTrigSingle:
         triggerMode.onOff = true;
-        triggerMode.mode = 0;
+        triggerMode.mode = multi_shot ? TRIGGER_MODE_MULTI_SHOT : TRIGGER_MODE_EDGE;
+        triggerMode.parameter = multi_shot ? nb_frames : 0;
+        triggerMode.source = 0;
+        break;
+    case IntTrigMult:
+        triggerMode.onOff = true;
+        triggerMode.mode = TRIGGER_MODE_EDGE;
+        triggerMode.parameter = 0;
+        triggerMode.source = TRIGGER_SOURCE_SOFTWARE;
+        break;
+    case ExtTrigMult:
+        triggerMode.onOff = true;
+        triggerMode.mode = TRIGGER_MODE_EDGE;
+        triggerMode.parameter = 0;
+        triggerMode.source = 0;
+        break;
+    case ExtGate:
+        triggerMode.onOff = true;
+        triggerMode.mode = TRIGGER_MODE_BULB;
+        triggerMode.parameter = 0;
         triggerMode.source = 0;
         break;
     default:
         THROW_HW_ERROR(Error) << "Trigger mode " << mode << " is not supported";
     }
 
-    m_error = m_camera->SetTriggerMode(&triggerMode);
-    if (m_error != FlyCapture2::PGRERROR_OK)
-        THROW_HW_ERROR(Error) << "Unable to set trigger mode settings: " << m_error.GetDescription();
+    if (triggerMode.onOff != current.onOff ||
+        (triggerMode.onOff && (triggerMode.mode != current.mode ||
+                               triggerMode.parameter != current.parameter ||
+                               triggerMode.source != current.source)))
+    {
+        m_error = m_camera->SetTriggerMode(&triggerMode);
+        if (m_error != FlyCapture2::PGRERROR_OK)
+            THROW_HW_ERROR(Error) << "Unable to set trigger mode settings: " << m_error.GetDescription();
+    }
+    m_applied_trig_mode = mode;
 }
 
 //-----------------------------------------------------
@@ -453,7 +2555,8 @@ void Camera::setNbFrames(int nb_frames)
 void Camera::getNbHwAcquiredFrames(int &nb_acq_frames)
 {
     DEB_MEMBER_FUNCT();
-    nb_acq_frames = m_image_number;
+    // Lima frames, not camera ones
+    nb_acq_frames = m_image_number / m_acc_nb_frames;
 }
 
 //-----------------------------------------------------
@@ -475,6 +2578,45 @@ HwBufferCtrlObj* Camera::getBufferCtrlObj()
     return &m_buffer_ctrl_obj;
 }
 
+//-----------------------------------------------------
+// roi: grow [offset, offset + size) to the camera offset
+// and size steps, keeping it inside [0, max)
+//-----------------------------------------------------
+static void _alignRoiAxis(int& offset, int& size, int max,
+                          int offset_step, int size_step)
+{
+    if (offset_step < 1)
+        offset_step = 1;
+    if (size_step < 1)
+        size_step = 1;
+
+    int end = offset + size;
+    offset -= offset % offset_step;
+    size = end - offset;
+    if (size % size_step)
+        size += size_step - size % size_step;
+
+    if (size > max)
+    {
+        offset = 0;
+        size = max;
+    }
+    else if (offset + size > max)
+    {
+        // moved back inside, then stretched to max by whole
+        // size steps as the aligned offset may come lower
+        offset = max - size;
+        offset -= offset % offset_step;
+        size = max - offset;
+        size -= size % size_step;
+        if (offset + size < end)
+        {
+            offset = 0;
+            size = max;
+        }
+    }
+}
+
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
@@ -482,6 +2624,25 @@ void Camera::checkRoi(const Roi& set_roi, Roi& hw_roi)
 {
     DEB_MEMBER_FUNCT();
     DEB_PARAM() << DEB_VAR1(set_roi);
+
+    if (!set_roi.isActive())
+        hw_roi = set_roi;
+    else
+    {
+        Point top_left = set_roi.getTopLeft();
+        Size size = set_roi.getSize();
+        int x = top_left.x, width = size.getWidth();
+        int y = top_left.y, height = size.getHeight();
+
+        _alignRoiAxis(x, width, m_image_settings_info.maxWidth,
+                      m_image_settings_info.offsetHStepSize,
+                      m_image_settings_info.imageHStepSize);
+        _alignRoiAxis(y, height, m_image_settings_info.maxHeight,
+                      m_image_settings_info.offsetVStepSize,
+                      m_image_settings_info.imageVStepSize);
+
+        hw_roi = Roi(x, y, width, height);
+    }
     DEB_RETURN() << DEB_VAR1(hw_roi);
 }
 
@@ -491,6 +2652,8 @@ void Camera::checkRoi(const Roi& set_roi, Roi& hw_roi)
 void Camera::getRoi(Roi& hw_roi)
 {
     DEB_MEMBER_FUNCT();
+    hw_roi = Roi(m_image_settings.offsetX, m_image_settings.offsetY,
+                 m_image_settings.width, m_image_settings.height);
     DEB_RETURN() << DEB_VAR1(hw_roi);
 }
 
@@ -501,6 +2664,45 @@ void Camera::setRoi(const Roi& ask_roi)
 {
     DEB_MEMBER_FUNCT();
     DEB_PARAM() << DEB_VAR1(ask_roi);
+
+    Roi hw_roi;
+    if (ask_roi.isActive())
+        checkRoi(ask_roi, hw_roi);
+    else
+        hw_roi = Roi(0, 0, m_image_settings_info.maxWidth, m_image_settings_info.maxHeight);
+
+    Point top_left = hw_roi.getTopLeft();
+    Size size = hw_roi.getSize();
+
+    if (top_left.x == int(m_image_settings.offsetX) &&
+        top_left.y == int(m_image_settings.offsetY) &&
+        size.getWidth() == int(m_image_settings.width) &&
+        size.getHeight() == int(m_image_settings.height))
+        // nothing to do
+        return;
+
+    if (m_acq_started)
+        THROW_HW_ERROR(Error) << "Acquisition in progress";
+
+    ImageSettings_t old_settings = m_image_settings;
+    m_image_settings.offsetX = top_left.x;
+    m_image_settings.offsetY = top_left.y;
+    m_image_settings.width = size.getWidth();
+    m_image_settings.height = size.getHeight();
+    if (m_deferred_config)
+    {
+        m_staged.has_image_settings = true;
+        return;
+    }
+    try
+    {
+        _applyImageSettings();
+    }
+    catch (Exception &e)
+    {
+        m_image_settings = old_settings;
+        THROW_HW_ERROR(Error) << e.getErrDesc();
+    }
 }
 
 //-----------------------------------------------------
@@ -509,6 +2711,21 @@ void Camera::setRoi(const Roi& ask_roi)
 void Camera::checkBin(Bin &aBin)
 {
     DEB_MEMBER_FUNCT();
+    DEB_PARAM() << DEB_VAR1(aBin);
+
+    _getBinList();
+
+    // Largest supported binning not exceeding the requested one
+    Bin best(1, 1);
+    for (std::vector<Bin>::const_iterator i = m_bin_list.begin(); i != m_bin_list.end(); ++i)
+    {
+        if (i->getX() > aBin.getX() || i->getY() > aBin.getY())
+            continue;
+        if (i->getX() * i->getY() > best.getX() * best.getY())
+            best = *i;
+    }
+    aBin = best;
+
     DEB_RETURN() << DEB_VAR1(aBin);
 }
 
@@ -518,6 +2735,7 @@ void Camera::checkBin(Bin &aBin)
 void Camera::getBin(Bin &aBin)
 {
     DEB_MEMBER_FUNCT();
+    aBin = m_bin;
     DEB_RETURN() << DEB_VAR1(aBin);
 }
 
@@ -527,7 +2745,135 @@ void Camera::getBin(Bin &aBin)
 void Camera::setBin(const Bin &aBin)
 {
     DEB_MEMBER_FUNCT();
-    DEB_RETURN() << DEB_VAR1(aBin);
+    DEB_PARAM() << DEB_VAR1(aBin);
+
+    if (aBin == m_bin)
+        // nothing to do
+        return;
+
+    if (m_acq_started)
+        THROW_HW_ERROR(Error) << "Acquisition in progress";
+
+    _getBinList();
+
+    int bin_index = -1;
+    for (unsigned int i = 0; i < m_bin_list.size(); ++i)
+        if (m_bin_list[i] == aBin)
+            bin_index = i;
+    if (bin_index < 0)
+        THROW_HW_ERROR(InvalidValue) << "Unsupported binning " << aBin;
+
+    _applyBin(bin_index);
+}
+
+//-----------------------------------------------------
+// Build the list of binnings supported by the camera
+//-----------------------------------------------------
+void Camera::_getBinList()
+{
+    DEB_MEMBER_FUNCT();
+    if (!m_bin_list.empty())
+        return;
+
+#ifdef USE_GIGE
+    // GigE cameras do not describe their binning capabilities,
+    // each candidate is probed and the current binning restored.
+    // Done once by _init, before the image settings are applied
+    static const unsigned int candidates[] = {1, 2, 4};
+    static const int nb_candidates = sizeof(candidates) / sizeof(candidates[0]);
+
+    for (int i = 0; i < nb_candidates; ++i)
+        for (int j = 0; j < nb_candidates; ++j)
+        {
+            BackendError error;
+            error = m_camera->SetGigEImageBinningSettings(candidates[i], candidates[j]);
+            if (error == FlyCapture2::PGRERROR_OK)
+                m_bin_list.push_back(Bin(candidates[i], candidates[j]));
+        }
+
+    m_error = m_camera->SetGigEImageBinningSettings(m_bin.getX(), m_bin.getY());
+    if (m_error != FlyCapture2::PGRERROR_OK)
+        THROW_HW_ERROR(Error) << "Failed to restore binning: " << m_error.GetDescription();
+#else
+    // Format7 binned readouts are modes whose maximum size is an
+    // integer fraction of the full mode 0 size
+    FlyCapture2::Format7Info mode0_info, info;
+    bool supported;
+
+    mode0_info.mode = FlyCapture2::MODE_0;
+    m_error = m_camera->GetFormat7Info(&mode0_info, &supported);
+    if (m_error != FlyCapture2::PGRERROR_OK || !supported)
+        THROW_HW_ERROR(Error) << "Failed to get Format7 info: " << m_error.GetDescription();
+
+    for (int mode = FlyCapture2::MODE_0; mode <= FlyCapture2::MODE_7; ++mode)
+    {
+        info.mode = FlyCapture2::Mode(mode);
+        BackendError error = m_camera->GetFormat7Info(&info, &supported);
+        if (error != FlyCapture2::PGRERROR_OK || !supported ||
+            !info.maxWidth || !info.maxHeight ||
+            mode0_info.maxWidth % info.maxWidth || mode0_info.maxHeight % info.maxHeight)
+            continue;
+
+        Bin bin(mode0_info.maxWidth / info.maxWidth, mode0_info.maxHeight / info.maxHeight);
+        bool known = false;
+        for (unsigned int i = 0; i < m_bin_list.size(); ++i)
+            known |= (m_bin_list[i] == bin);
+        if (known)
+            continue;
+
+        m_bin_list.push_back(bin);
+        m_bin_modes.push_back(info.mode);
+    }
+#endif
+    if (m_bin_list.empty())
+        m_bin_list.push_back(Bin(1, 1));
+
+    DEB_TRACE() << DEB_VAR1(m_bin_list.size());
+}
+
+//-----------------------------------------------------
+// Switch to the binning, resetting the image to the full
+// binned frame
+//-----------------------------------------------------
+void Camera::_applyBin(int bin_index)
+{
+    DEB_MEMBER_FUNCT();
+    const Bin& bin = m_bin_list[bin_index];
+    DEB_PARAM() << DEB_VAR1(bin);
+
+    Bin old_bin = m_bin;
+    ImageSettingsInfo_t old_info = m_image_settings_info;
+    ImageSettings_t old_settings = m_image_settings;
+
+    try
+    {
+#ifdef USE_GIGE
+        _closeIdleStream();
+        m_error = m_camera->SetGigEImageBinningSettings(bin.getX(), bin.getY());
+        if (m_error != FlyCapture2::PGRERROR_OK)
+            THROW_HW_ERROR(Error) << "Failed to set binning: " << m_error.GetDescription();
+#else
+        m_image_settings.mode = m_bin_modes[bin_index];
+#endif
+        m_bin = bin;
+        _getImageSettingsInfo();
+
+        m_image_settings.offsetX = 0;
+        m_image_settings.offsetY = 0;
+        m_image_settings.width = m_image_settings_info.maxWidth;
+        m_image_settings.height = m_image_settings_info.maxHeight;
+        _applyImageSettings();
+    }
+    catch (Exception &e)
+    {
+        m_bin = old_bin;
+        m_image_settings_info = old_info;
+        m_image_settings = old_settings;
+#ifdef USE_GIGE
+        m_camera->SetGigEImageBinningSettings(m_bin.getX(), m_bin.getY());
+#endif
+        THROW_HW_ERROR(Error) << e.getErrDesc();
+    }
 }
 
 //-----------------------------------------------------
@@ -536,7 +2882,10 @@ void Camera::setBin(const Bin &aBin)
 void Camera::getExpTime(double& exp_time)
 {
     DEB_MEMBER_FUNCT();
-    _getPropertyValue(FlyCapture2::SHUTTER, exp_time);
+    if (m_staged.has_exp_time)
+        exp_time = m_staged.exp_time;
+    else
+        _getPropertyValue(FlyCapture2::SHUTTER, exp_time);
     DEB_RETURN() << DEB_VAR1(exp_time);
 }
 
@@ -547,7 +2896,13 @@ void Camera::setExpTime(double exp_time)
 {
     DEB_MEMBER_FUNCT();
     DEB_PARAM() << DEB_VAR1(exp_time);
-    _setPropertyValue(FlyCapture2::SHUTTER, exp_time);
+    if (m_deferred_config)
+    {
+        m_staged.has_exp_time = true;
+        m_staged.exp_time = exp_time;
+    }
+    else
+        _setPropertyValue(FlyCapture2::SHUTTER, exp_time);
 }
 
 //-----------------------------------------------------
@@ -586,7 +2941,10 @@ void Camera::setAutoExpTime(bool auto_exp_time)
 void Camera::getGain(double& gain)
 {
     DEB_MEMBER_FUNCT();
-    _getPropertyValue(FlyCapture2::GAIN, gain);
+    if (m_staged.has_gain)
+        gain = m_staged.gain;
+    else
+        _getPropertyValue(FlyCapture2::GAIN, gain);
     DEB_RETURN() << DEB_VAR1(gain);
 }
 
@@ -597,7 +2955,13 @@ void Camera::setGain(double gain)
 {
     DEB_MEMBER_FUNCT();
     DEB_PARAM() << DEB_VAR1(gain);
-    _setPropertyValue(FlyCapture2::GAIN, gain);
+    if (m_deferred_config)
+    {
+        m_staged.has_gain = true;
+        m_staged.gain = gain;
+    }
+    else
+        _setPropertyValue(FlyCapture2::GAIN, gain);
 }
 
 //-----------------------------------------------------
@@ -636,7 +3000,10 @@ void Camera::setAutoGain(bool auto_gain)
 void Camera::getFrameRate(double& frame_rate)
 {
     DEB_MEMBER_FUNCT();
-    _getPropertyValue(FlyCapture2::FRAME_RATE, frame_rate);
+    if (m_staged.has_frame_rate)
+        frame_rate = m_staged.frame_rate;
+    else
+        _getPropertyValue(FlyCapture2::FRAME_RATE, frame_rate);
     DEB_RETURN() << DEB_VAR1(frame_rate);
 }
 
@@ -647,7 +3014,15 @@ void Camera::setFrameRate(double frame_rate)
 {
     DEB_MEMBER_FUNCT();
     DEB_PARAM() << DEB_VAR1(frame_rate);
-    _setPropertyValue(FlyCapture2::FRAME_RATE, frame_rate);
+    if (m_deferred_config)
+    {
+        // a frame rate value implies manual mode
+        m_staged.has_frame_rate = true;
+        m_staged.frame_rate = frame_rate;
+        m_staged.has_auto_frame_rate = false;
+    }
+    else
+        _setPropertyValue(FlyCapture2::FRAME_RATE, frame_rate);
 }
 
 //-----------------------------------------------------
@@ -666,7 +3041,12 @@ void Camera::getFrameRateRange(double& min_frame_rate, double& max_frame_rate)
 void Camera::getAutoFrameRate(bool& auto_frame_rate)
 {
     DEB_MEMBER_FUNCT();
-    _getPropertyAutoMode(FlyCapture2::FRAME_RATE, auto_frame_rate);
+    if (m_staged.has_auto_frame_rate)
+        auto_frame_rate = m_staged.auto_frame_rate;
+    else if (m_staged.has_frame_rate)
+        auto_frame_rate = false;
+    else
+        _getPropertyAutoMode(FlyCapture2::FRAME_RATE, auto_frame_rate);
     DEB_RETURN() << DEB_VAR1(auto_frame_rate);
 }
 
@@ -677,7 +3057,14 @@ void Camera::setAutoFrameRate(bool auto_frame_rate)
 {
     DEB_MEMBER_FUNCT();
     DEB_PARAM() << DEB_VAR1(auto_frame_rate);
-    _setPropertyAutoMode(FlyCapture2::FRAME_RATE, auto_frame_rate);
+    if (m_deferred_config)
+    {
+        m_staged.has_auto_frame_rate = true;
+        m_staged.auto_frame_rate = auto_frame_rate;
+        m_staged.has_frame_rate = false;
+    }
+    else
+        _setPropertyAutoMode(FlyCapture2::FRAME_RATE, auto_frame_rate);
 }
 
 //-----------------------------------------------------
@@ -688,10 +3075,7 @@ void Camera::_getPropertyValue(FlyCapture2::PropertyType type, double& value)
     DEB_MEMBER_FUNCT();
     FlyCapture2::Property property(type);
 
-    m_error = m_camera->GetProperty(&property);
-    if (m_error != FlyCapture2::PGRERROR_OK)
-        THROW_HW_ERROR(Error) << "Failed to get camera property: " << m_error.GetDescription();
-
+    _getProperty(type, property);
     value = property.absValue;
 }
 
@@ -708,9 +3092,7 @@ void Camera::_setPropertyValue(FlyCapture2::PropertyType type, double value)
     property.absControl = true;
     property.absValue = value;
 
-    m_error = m_camera->SetProperty(&property);
-    if (m_error != FlyCapture2::PGRERROR_OK)
-        THROW_HW_ERROR(Error) << "Failed to set camera property: " << m_error.GetDescription();
+    _setProperty(property);
 }
 
 //-----------------------------------------------------
@@ -721,10 +3103,7 @@ void Camera::_getPropertyRange(FlyCapture2::PropertyType type, double& min_value
     DEB_MEMBER_FUNCT();
     FlyCapture2::PropertyInfo property_info(type);
 
-    m_error = m_camera->GetPropertyInfo(&property_info);
-    if (m_error != FlyCapture2::PGRERROR_OK)
-        THROW_HW_ERROR(Error) << "Failed to get camera property info: " << m_error.GetDescription();
-
+    _getPropertyInfo(type, property_info);
     min_value = property_info.absMin;
     max_value = property_info.absMax;
 }
@@ -737,10 +3116,7 @@ void Camera::_getPropertyAutoMode(FlyCapture2::PropertyType type, bool& auto_mod
     DEB_MEMBER_FUNCT();
     FlyCapture2::Property property(type);
 
-    m_error = m_camera->GetProperty(&property);
-    if (m_error != FlyCapture2::PGRERROR_OK)
-        THROW_HW_ERROR(Error) << "Failed to get camera property: " << m_error.GetDescription();
-
+    _getProperty(type, property);
     auto_mode = property.autoManualMode;
 }
 
@@ -755,9 +3131,94 @@ void Camera::_setPropertyAutoMode(FlyCapture2::PropertyType type, bool auto_mode
     property.onOff = not auto_mode;
     property.autoManualMode = auto_mode;
 
+    _setProperty(property);
+}
+
+//-----------------------------------------------------
+// property cache
+//
+// Manual properties are read once from the camera and then
+// served from the cache, which follows every successful write.
+// Properties in auto mode are always read back from the camera.
+//-----------------------------------------------------
+void Camera::_getProperty(FlyCapture2::PropertyType type, FlyCapture2::Property& property)
+{
+    DEB_MEMBER_FUNCT();
+    PropertyCache::iterator i = m_property_cache.find(type);
+    if (i != m_property_cache.end() && !i->second.autoManualMode)
+    {
+        property = i->second;
+        return;
+    }
+
+    m_error = m_camera->GetProperty(&property);
+    if (m_error != FlyCapture2::PGRERROR_OK)
+        THROW_HW_ERROR(Error) << "Failed to get camera property: " << m_error.GetDescription();
+
+    m_property_cache[type] = property;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::_setProperty(const FlyCapture2::Property& property)
+{
+    DEB_MEMBER_FUNCT();
     m_error = m_camera->SetProperty(&property);
     if (m_error != FlyCapture2::PGRERROR_OK)
+    {
+        m_property_cache.erase(property.type);
         THROW_HW_ERROR(Error) << "Failed to set camera property: " << m_error.GetDescription();
+    }
+
+    // only a written manual value is known without reading back
+    if (property.absControl && !property.autoManualMode)
+        m_property_cache[property.type] = property;
+    else
+        m_property_cache.erase(property.type);
+
+    // The exposure range follows the frame period and the camera
+    // may clip the exposure to it, and conversely
+    if (property.type == FlyCapture2::FRAME_RATE)
+    {
+        m_property_cache.erase(FlyCapture2::SHUTTER);
+        m_property_info_cache.erase(FlyCapture2::SHUTTER);
+    }
+    else if (property.type == FlyCapture2::SHUTTER)
+    {
+        m_property_cache.erase(FlyCapture2::FRAME_RATE);
+        m_property_info_cache.erase(FlyCapture2::FRAME_RATE);
+    }
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::_getPropertyInfo(FlyCapture2::PropertyType type, FlyCapture2::PropertyInfo& property_info)
+{
+    DEB_MEMBER_FUNCT();
+    PropertyInfoCache::iterator i = m_property_info_cache.find(type);
+    if (i != m_property_info_cache.end())
+    {
+        property_info = i->second;
+        return;
+    }
+
+    m_error = m_camera->GetPropertyInfo(&property_info);
+    if (m_error != FlyCapture2::PGRERROR_OK)
+        THROW_HW_ERROR(Error) << "Failed to get camera property info: " << m_error.GetDescription();
+
+    m_property_info_cache[type] = property_info;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::refreshProperties()
+{
+    DEB_MEMBER_FUNCT();
+    m_property_cache.clear();
+    m_property_info_cache.clear();
 }
 
 //-----------------------------------------------------
@@ -777,17 +3238,134 @@ void Camera::_setStatus(Camera::Status status, bool force)
 void Camera::_forcePGRY16Mode()
 {
     DEB_MEMBER_FUNCT();
-    const unsigned int k_imageDataFmtReg = 0x1048;
     unsigned int value = 0;
-    m_error = m_camera->ReadRegister(k_imageDataFmtReg, &value);
+    m_error = m_camera->ReadRegister(IMAGE_DATA_FORMAT_REG, &value);
     if (m_error != FlyCapture2::PGRERROR_OK)
         THROW_HW_ERROR(Error) << "Failed to read camera register: " << m_error.GetDescription();
 
-    value &= ~0x1;
+    if (!(value & 0x1))
+        // already there
+        return;
 
-    m_error = m_camera->WriteRegister(k_imageDataFmtReg, value);
+    m_error = m_camera->WriteRegister(IMAGE_DATA_FORMAT_REG, value & ~0x1);
     if (m_error != FlyCapture2::PGRERROR_OK)
         THROW_HW_ERROR(Error) << "Failed to write camera register: " << m_error.GetDescription();
+
+    if (!m_y16_native_valid)
+    {
+        m_y16_native = value;
+        m_y16_native_valid = true;
+    }
+}
+
+//-----------------------------------------------------
+// frame ring
+//-----------------------------------------------------
+Camera::_FrameRing::_FrameRing(int size)
+    : m_slots(NULL)
+{
+    reset(size);
+}
+
+Camera::_FrameRing::~_FrameRing()
+{
+    delete [] m_slots;
+}
+
+void Camera::_FrameRing::reset(int size)
+{
+    DEB_MEMBER_FUNCT();
+    DEB_PARAM() << DEB_VAR1(size);
+
+    // Fresh images, so that no Lima buffer attached by a direct
+    // retrieve survives from one acquisition to the next
+    delete [] m_slots;
+    m_slots = new Slot[size];
+    m_size = size;
+    m_head = m_tail = 0;
+    m_high_water = 0;
+    m_producer_waiting = m_consumer_waiting = false;
+}
+
+Camera::_FrameRing::Slot *Camera::_FrameRing::producerSlot(double timeout)
+{
+    if (int(m_head - m_tail) >= m_size)
+    {
+        AutoMutex lock(m_cond.mutex());
+        m_producer_waiting = true;
+        __sync_synchronize();
+        if (int(m_head - m_tail) >= m_size)
+            m_cond.wait(timeout);
+        m_producer_waiting = false;
+        if (int(m_head - m_tail) >= m_size)
+            return NULL;
+    }
+    return &m_slots[m_head % m_size];
+}
+
+void Camera::_FrameRing::push()
+{
+    // publish the slot content before the new head
+    __sync_synchronize();
+    int occupancy = ++m_head - m_tail;
+    if (occupancy > m_high_water)
+        m_high_water = occupancy;
+    __sync_synchronize();
+    if (m_consumer_waiting)
+        _signal();
+}
+
+bool Camera::_FrameRing::waitEmpty(double timeout)
+{
+    if (m_head != m_tail)
+    {
+        AutoMutex lock(m_cond.mutex());
+        m_producer_waiting = true;
+        __sync_synchronize();
+        if (m_head != m_tail)
+            m_cond.wait(timeout);
+        m_producer_waiting = false;
+    }
+    return m_head == m_tail;
+}
+
+Camera::_FrameRing::Slot *Camera::_FrameRing::consumerSlot(double timeout)
+{
+    if (m_head == m_tail)
+    {
+        AutoMutex lock(m_cond.mutex());
+        m_consumer_waiting = true;
+        __sync_synchronize();
+        if (m_head == m_tail)
+            m_cond.wait(timeout);
+        m_consumer_waiting = false;
+        if (m_head == m_tail)
+            return NULL;
+    }
+    // read the slot content only after the head
+    __sync_synchronize();
+    return &m_slots[m_tail % m_size];
+}
+
+void Camera::_FrameRing::pop()
+{
+    // the slot is released only once fully consumed
+    __sync_synchronize();
+    ++m_tail;
+    __sync_synchronize();
+    if (m_producer_waiting)
+        _signal();
+}
+
+void Camera::_FrameRing::wakeup()
+{
+    _signal();
+}
+
+void Camera::_FrameRing::_signal()
+{
+    AutoMutex lock(m_cond.mutex());
+    m_cond.broadcast();
 }
 
 //-----------------------------------------------------
@@ -795,7 +3373,7 @@ void Camera::_forcePGRY16Mode()
 //-----------------------------------------------------
 Camera::_AcqThread::_AcqThread(Camera &cam) : m_cam(cam)
 {
-    pthread_attr_setscope(&m_thread_attr, PTHREAD_SCOPE_PROCESS);
+    pthread_attr_setscope(&m_thread_attr, PTHREAD_SCOPE_SYSTEM);
 }
 
 Camera::_AcqThread::~_AcqThread()
@@ -808,68 +3386,255 @@ Camera::_AcqThread::~_AcqThread()
     join();
 }
 
-void Camera::_AcqThread::threadFunction()
+//-----------------------------------------------------
+// cpus, policy and priority of the calling thread, then
+// what the kernel granted. Called with the camera lock held
+//-----------------------------------------------------
+void Camera::_AcqThread::_applyScheduling()
 {
     DEB_MEMBER_FUNCT();
-    FlyCapture2::Error error;
-    FlyCapture2::Image image;
+    pthread_t self = pthread_self();
+
+    cpu_set_t cpu_set;
+    _parseCpuList(m_cam.m_acq_cpus, cpu_set);
+    if (pthread_setaffinity_np(self, sizeof(cpu_set), &cpu_set))
+        DEB_ERROR() << "Could not pin acquisition thread on cpus " << m_cam.m_acq_cpus;
 
+    int policy = _posixSchedPolicy(m_cam.m_acq_policy);
+    int min_priority = sched_get_priority_min(policy);
+    int max_priority = sched_get_priority_max(policy);
     sched_param param;
-    param.sched_priority = sched_get_priority_max(SCHED_FIFO);
-    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param))
+    param.sched_priority = m_cam.m_acq_priority;
+    if (param.sched_priority == -1 || param.sched_priority > max_priority)
+        param.sched_priority = max_priority;
+    else if (param.sched_priority < min_priority)
+        param.sched_priority = min_priority;
+    if (pthread_setschedparam(self, policy, &param))
+        DEB_ERROR() << "Could not set scheduling of acquisition thread: "
+                     << DEB_VAR2(m_cam.m_acq_policy, param.sched_priority);
+
+    if (!pthread_getaffinity_np(self, sizeof(cpu_set), &cpu_set))
+        m_cam.m_applied_acq_cpus = _formatCpuList(cpu_set);
+    if (!pthread_getschedparam(self, &policy, &param))
     {
-        DEB_ERROR() << "Could not set FIFO scheduling for acquisition thread";
+        m_cam.m_applied_acq_policy = _cameraSchedPolicy(policy);
+        m_cam.m_applied_acq_priority = param.sched_priority;
     }
+    DEB_TRACE() << DEB_VAR3(m_cam.m_applied_acq_cpus, m_cam.m_applied_acq_policy,
+                            m_cam.m_applied_acq_priority);
+
+    m_cam.m_acq_sched_changed = false;
+}
+
+void Camera::_AcqThread::threadFunction()
+{
+    DEB_MEMBER_FUNCT();
+    BackendError error;
 
     AutoMutex lock(m_cam.m_cond.mutex());
+    _applyScheduling();
     StdBufferCbMgr& buffer_mgr = m_cam.m_buffer_ctrl_obj.getBuffer();
+    _FrameRing& ring = *m_cam.m_ring;
+    FlyCapture2::Image idle_image;
 
     while (true)
     {
         while (!m_cam.m_acq_started && !m_cam.m_quit)
         {
-            DEB_TRACE() << "Wait";
             m_cam.m_thread_running = false;
             m_cam.m_cond.broadcast();
-            m_cam.m_cond.wait();
+            if (!m_cam.m_stream_open)
+            {
+                DEB_TRACE() << "Wait";
+                m_cam.m_cond.wait();
+                continue;
+            }
+
+            // Armed idle: keep the driver buffers drained. Every frame
+            // retrieved here is discarded, even one coming in as the
+            // gate opens: it may have been exposed before startAcq.
+            // The acquisition starts with the first frame retrieved
+            // into a ring slot, idle_image never holds a Lima buffer
+            lock.unlock();
+            error = m_cam.m_camera->RetrieveBuffer(&idle_image);
+            lock.lock();
+            if (error != FlyCapture2::PGRERROR_OK && error != FlyCapture2::PGRERROR_TIMEOUT &&
+                !m_cam.m_acq_started && !m_cam.m_quit)
+                // the stream is being closed
+                m_cam.m_cond.wait(RING_WAIT_TIMEOUT);
         }
         if (m_cam.m_quit) return;
 
+        // set from the thread itself, picked up at each start
+        if (m_cam.m_acq_sched_changed)
+            _applyScheduling();
+
         m_cam.m_thread_running = true;
+        m_cam.m_retrieving = true;
         m_cam.m_status = Camera::Exposure;
         lock.unlock();
 
         DEB_TRACE() << "Run";
+        // camera frames, m_acc_nb_frames per Lima frame
+        int nb_frames = m_cam.m_nb_frames * m_cam.m_acc_nb_frames;
         bool continue_acq = true;
-
-        continue_acq = true;
-
-        while (continue_acq && (!m_cam.m_nb_frames || m_cam.m_image_number < m_cam.m_nb_frames))
+        bool hw_clock_anchored = false;
+        bool counter_set = false;
+        unsigned int last_counter = 0;
+        int inconsistent = 0;
+        const FrameDim& fDim = buffer_mgr.getFrameDim();
+        bool direct_retrieve = m_cam.m_direct_retrieve && m_cam._isDirectFormat();
+        int nb_buffers;
+        buffer_mgr.getNbBuffers(nb_buffers);
+
+        // Only drain the driver here, frames are handed over to
+        // the dispatch thread through the ring
+        while (continue_acq && (!nb_frames || m_cam.m_image_number < nb_frames))
         {
-            error = m_cam.m_camera->RetrieveBuffer(&image);
-            if (error == FlyCapture2::PGRERROR_OK)
+            _FrameRing::Slot *slot = ring.producerSlot(RING_WAIT_TIMEOUT);
+            if (!slot)
             {
-                // Grabbing was successful, process image
-                m_cam._setStatus(Camera::Readout, false);
+                // ring full, dispatch is lagging behind
+                continue_acq = m_cam.m_acq_started && m_cam.m_dispatch_continue;
+                continue;
+            }
 
-                DEB_TRACE() << "image# " << m_cam.m_image_number << " acquired";
+            // The driver copies the frame into the Lima buffer rather
+            // than into a ring image, nothing left to copy at dispatch.
+            // Only while that buffer is not one of a frame still on
+            // its way to Lima, the slot image is used otherwise
+            slot->image = &slot->own_image;
+            if (direct_retrieve &&
+                m_cam.m_image_number - m_cam.m_dispatched_frames < nb_buffers - 1)
+            {
                 void* framePt = buffer_mgr.getFrameBufferPtr(m_cam.m_image_number);
-                const FrameDim& fDim = buffer_mgr.getFrameDim();
-                memcpy(framePt, image.GetData(), fDim.getMemSize());
+                slot->lima_image.SetData((unsigned char *) framePt, fDim.getMemSize());
+                slot->image = &slot->lima_image;
+            }
 
-                HwFrameInfoType frame_info;
-                frame_info.acq_frame_nb = m_cam.m_image_number;
-                continue_acq = buffer_mgr.newFrameReady(frame_info);
-                m_cam.m_image_number++;
+            double t0 = m_cam.m_latency_stats ? LatencyHistogram::now() : 0;
+            error = m_cam.m_camera->RetrieveBuffer(slot->image);
+            if (m_cam.m_latency_stats)
+                m_cam.m_latency[RetrieveStage].record(LatencyHistogram::now() - t0);
+            if (error == FlyCapture2::PGRERROR_OK)
+            {
+                DEB_TRACE() << "image# " << m_cam.m_image_number << " acquired";
+                if (m_cam.m_applied_trig_mode == IntTrigMult)
+                {
+                    double latency = LatencyHistogram::now() - m_cam.m_trigger_time;
+                    m_cam.m_trigger_latency = latency;
+                    if (m_cam.m_latency_stats)
+                        m_cam.m_latency[TriggerStage].record(latency);
+                }
+                double now = Timestamp::now();
+                bool has_counter = false;
+                slot->frame_nb = m_cam.m_image_number;
+                slot->frame_counter = m_cam.m_image_number;
+                slot->timestamp = now;
+                slot->nb_blank = 0;
+                slot->valid = true;
+                if (m_cam.m_hw_timestamp || m_cam.m_hw_frame_counter)
+                {
+                    FlyCapture2::TimeStamp timestamp;
+                    FlyCapture2::ImageMetadata metadata;
+                    error = m_cam.m_camera->GetImageMetadata(slot->image, &timestamp, &metadata);
+                    if (error != FlyCapture2::PGRERROR_OK)
+                        DEB_WARNING() << "No image metadata: " << error.GetDescription();
+                    else
+                    {
+                        // the first frame anchors the camera clock on the host one
+                        if (m_cam.m_hw_timestamp)
+                        {
+                            slot->timestamp = m_cam._hwTimestamp(timestamp, now, !hw_clock_anchored);
+                            hw_clock_anchored = true;
+                        }
+                        if (m_cam.m_hw_frame_counter)
+                        {
+                            slot->frame_counter = metadata.embeddedFrameCounter;
+                            has_counter = true;
+                        }
+                    }
+                }
+
+                // Frames lost since the previous one: a gap in the
+                // camera counter, else the inconsistent ones only
+                int lost = inconsistent;
+                if (has_counter)
+                {
+                    if (counter_set)
+                    {
+                        lost = int(slot->frame_counter - last_counter - 1);
+                        if (lost > inconsistent)
+                            m_cam.m_dropped_frames += lost - inconsistent;
+                    }
+                    else
+                        lost = 0;
+                    counter_set = true;
+                    last_counter = slot->frame_counter;
+                }
+                inconsistent = 0;
+
+                if (lost > 0 && m_cam.m_drop_policy == DropFault)
+                {
+                    DEB_ERROR() << lost << " frame(s) lost before image# " << m_cam.m_image_number;
+                    m_cam._setStatus(Camera::Fault, false);
+                    continue_acq = false;
+                    continue;
+                }
+                if (lost > 0 && m_cam.m_drop_policy == DropPlaceholder)
+                {
+                    // blank frames keep acq_frame_nb on the trigger count
+                    if (nb_frames && m_cam.m_image_number + lost >= nb_frames)
+                    {
+                        lost = nb_frames - m_cam.m_image_number;
+                        slot->valid = false;
+                    }
+                    slot->nb_blank = lost;
+                    slot->frame_nb += lost;
+                    m_cam.m_image_number += lost;
+                }
+
+                m_cam.m_acq_bytes += slot->image->GetReceivedDataSize();
+                m_cam.m_last_frame_time = now;
+                if (m_cam.m_auto_packet_delay && now - m_cam.m_tune_time >= PACKET_DELAY_TUNE_PERIOD)
+                    m_cam._tunePacketDelay(now);
+
+                ring.push();
+                if (slot->valid)
+                    m_cam.m_image_number++;
+                continue_acq = m_cam.m_acq_started && m_cam.m_dispatch_continue;
             }
             else if (error == FlyCapture2::PGRERROR_ISOCH_NOT_STARTED)
             {
                 DEB_TRACE() << "Acquisition aborted";
                 continue_acq = false;
             }
+            else if (error == FlyCapture2::PGRERROR_TIMEOUT)
+            {
+                // The driver is only polled, the grab timeout runs
+                // from the start or the last frame
+                int grab_timeout = m_cam.m_stream_config.grabTimeout;
+                double waited = Timestamp::now() - m_cam.m_last_frame_time;
+                if (grab_timeout >= 0 && waited * 1e3 >= grab_timeout)
+                {
+                    DEB_ERROR() << "No image acquired within the grab timeout: "
+                                << DEB_VAR2(grab_timeout, waited);
+                    m_cam._setStatus(Camera::Fault, false);
+                    continue_acq = false;
+                }
+                else
+                    continue_acq = m_cam.m_acq_started && m_cam.m_dispatch_continue;
+            }
             else if (error == FlyCapture2::PGRERROR_IMAGE_CONSISTENCY_ERROR)
             {
                 DEB_WARNING() << "No image acquired: " << error.GetDescription();
+                m_cam.m_inconsistent_frames++;
+                inconsistent++;
+                if (m_cam.m_drop_policy == DropFault)
+                {
+                    m_cam._setStatus(Camera::Fault, false);
+                    continue_acq = false;
+                }
             }
             else
             {
@@ -878,8 +3643,261 @@ void Camera::_AcqThread::threadFunction()
                 continue_acq = false;
             }
         }
-        m_cam.stopAcq();
+
+        // out of the driver, a waiting stopAcq can return
         lock.lock();
+        m_cam.m_retrieving = false;
+        m_cam.m_cond.broadcast();
+        lock.unlock();
+
+        // Let the dispatch thread deliver what has been retrieved
+        while (!ring.waitEmpty(RING_WAIT_TIMEOUT) && !m_cam.m_quit)
+            ;
+
+        // a stream left armed must have delivered the whole sequence
+        bool completed = nb_frames && m_cam.m_image_number >= nb_frames;
+        m_cam._stopAcq(completed);
+        lock.lock();
+    }
+}
+
+//-----------------------------------------------------
+// statistics thread, away from the frame path
+//-----------------------------------------------------
+Camera::_StatsThread::_StatsThread(Camera &cam)
+    : m_cam(cam)
+    , m_quit(false)
+{
+}
+
+Camera::_StatsThread::~_StatsThread()
+{
+    AutoMutex lock(m_cond.mutex());
+    m_quit = true;
+    m_cond.broadcast();
+    lock.unlock();
+
+    join();
+}
+
+void Camera::_StatsThread::threadFunction()
+{
+    DEB_MEMBER_FUNCT();
+    AutoMutex lock(m_cond.mutex());
+    while (!m_quit)
+    {
+        if (m_cam.m_acq_started)
+        {
+            lock.unlock();
+            m_cam._pollStats();
+            lock.lock();
+        }
+        if (!m_quit)
+            m_cond.wait(STATS_POLL_PERIOD);
+    }
+}
+
+//-----------------------------------------------------
+// dispatch thread
+//-----------------------------------------------------
+Camera::_DispatchThread::_DispatchThread(Camera &cam)
+    : m_cam(cam)
+    , m_acc_saturated(0)
+{
+}
+
+Camera::_DispatchThread::~_DispatchThread()
+{
+    AutoMutex lock(m_cam.m_cond.mutex());
+    m_cam.m_quit = true;
+    m_cam.m_cond.broadcast();
+    lock.unlock();
+    m_cam.m_ring->wakeup();
+
+    join();
+}
+
+void Camera::_DispatchThread::threadFunction()
+{
+    DEB_MEMBER_FUNCT();
+    StdBufferCbMgr& buffer_mgr = m_cam.m_buffer_ctrl_obj.getBuffer();
+    _FrameRing& ring = *m_cam.m_ring;
+    Timestamp last_timestamp;
+
+    while (!m_cam.m_quit)
+    {
+        if (m_cam.m_dispatch_park)
+        {
+            // out of the ring until prepareAcq has reset it
+            AutoMutex lock(m_cam.m_cond.mutex());
+            m_cam.m_dispatch_idle = true;
+            m_cam.m_cond.broadcast();
+            while (m_cam.m_dispatch_park && !m_cam.m_quit)
+                m_cam.m_cond.wait();
+            m_cam.m_dispatch_idle = false;
+            continue;
+        }
+
+        _FrameRing::Slot *slot = ring.consumerSlot(RING_WAIT_TIMEOUT);
+        if (!slot)
+            continue;
+
+        // Summed up into the Lima frames, the lost ones add nothing
+        if (m_cam.m_dispatch_continue && m_cam.m_acc_nb_frames > 1)
+        {
+            m_cam._setStatus(Camera::Readout, false);
+            int first_nb = slot->frame_nb - slot->nb_blank;
+            for (int i = 0; i < slot->nb_blank && m_cam.m_dispatch_continue; ++i)
+                _accumulate(first_nb + i, NULL, slot->timestamp);
+            if (slot->valid && m_cam.m_dispatch_continue)
+            {
+                m_cam.m_last_frame_counter = slot->frame_counter;
+                _accumulate(slot->frame_nb, slot->image, slot->timestamp);
+            }
+            ring.pop();
+            continue;
+        }
+
+        // Once Lima refused a frame, the remaining ones are dropped
+        if (m_cam.m_dispatch_continue)
+        {
+            bool timed = m_cam.m_latency_stats;
+            double t0 = timed ? LatencyHistogram::now() : 0;
+            double t1;
+
+            m_cam._setStatus(Camera::Readout, false);
+            if (timed)
+            {
+                t1 = LatencyHistogram::now();
+                m_cam.m_latency[StatusStage].record(t1 - t0);
+            }
+
+            void* framePt = buffer_mgr.getFrameBufferPtr(slot->frame_nb);
+            const FrameDim& fDim = buffer_mgr.getFrameDim();
+            // Copied before blanking, a directly retrieved frame may
+            // sit in the buffer of the first blank one
+            if (slot->valid && (slot->image->GetData() != framePt || m_cam.m_y16_swap))
+            {
+                _copyImage(*slot->image, framePt, fDim.getMemSize(), m_cam.m_y16_swap,
+                           m_cam.m_bayer_rgb, m_cam.m_bayer_mode == BayerLuminance);
+                if (timed)
+                    m_cam.m_latency[CopyStage].record(LatencyHistogram::now() - t1);
+            }
+
+            int first_nb = slot->frame_nb - slot->nb_blank;
+            if (first_nb == 0)
+                last_timestamp = m_cam.m_start_timestamp;
+            for (int i = 0; i < slot->nb_blank && m_cam.m_dispatch_continue; ++i)
+            {
+                void* blankPt = buffer_mgr.getFrameBufferPtr(first_nb + i);
+                memset(blankPt, 0, fDim.getMemSize());
+
+                // evenly spread between the surrounding frames
+                HwFrameInfoType frame_info;
+                frame_info.acq_frame_nb = first_nb + i;
+                double last = last_timestamp - m_cam.m_start_timestamp;
+                double step = (slot->timestamp - last_timestamp) / (slot->nb_blank + 1);
+                frame_info.frame_timestamp = last + step * (i + 1);
+                m_cam.m_dispatch_continue = buffer_mgr.newFrameReady(frame_info);
+            }
+
+            if (slot->valid && m_cam.m_dispatch_continue)
+            {
+                m_cam.m_last_frame_counter = slot->frame_counter;
+
+                // camera or retrieve time, not dispatch time
+                HwFrameInfoType frame_info;
+                frame_info.acq_frame_nb = slot->frame_nb;
+                frame_info.frame_timestamp = slot->timestamp - m_cam.m_start_timestamp;
+                t0 = timed ? LatencyHistogram::now() : 0;
+                m_cam.m_dispatch_continue = buffer_mgr.newFrameReady(frame_info);
+                if (timed)
+                    m_cam.m_latency[NewFrameReadyStage].record(LatencyHistogram::now() - t0);
+
+                // ready for the next software trigger
+                if (m_cam.m_applied_trig_mode == IntTrigMult)
+                    m_cam._setStatus(Camera::Ready, false);
+            }
+            last_timestamp = slot->timestamp;
+        }
+        // its buffer is Lima's now, a direct retrieve can reuse it
+        m_cam.m_dispatched_frames = slot->frame_nb + 1;
+        ring.pop();
     }
 }
 
+//-----------------------------------------------------
+// Adds camera frame frame_nb, NULL when lost, to Lima frame
+// frame_nb / m_acc_nb_frames. That one goes out with its last
+// camera frame, time stamped by its first one
+//-----------------------------------------------------
+void Camera::_DispatchThread::_accumulate(int frame_nb, FlyCapture2::Image *image,
+                                          const Timestamp& timestamp)
+{
+    DEB_MEMBER_FUNCT();
+    StdBufferCbMgr& buffer_mgr = m_cam.m_buffer_ctrl_obj.getBuffer();
+    const FrameDim& fDim = buffer_mgr.getFrameDim();
+    int acc_nb = frame_nb / m_cam.m_acc_nb_frames;
+    int pos = frame_nb % m_cam.m_acc_nb_frames;
+    bool first = (pos == 0);
+    bool timed = m_cam.m_latency_stats;
+    double t0 = timed ? LatencyHistogram::now() : 0;
+
+    unsigned int *sum = (unsigned int *) buffer_mgr.getFrameBufferPtr(acc_nb);
+    size_t nb_pixels = size_t(fDim.getSize().getWidth()) * fDim.getSize().getHeight();
+    if (first)
+    {
+        m_acc_timestamp = timestamp;
+        m_acc_saturated = 0;
+    }
+
+    if (image)
+    {
+        FlyCapture2::PixelFormat format = image->GetPixelFormat();
+        bool wide = (format == FlyCapture2::PIXEL_FORMAT_MONO12 ||
+                     format == FlyCapture2::PIXEL_FORMAT_MONO16 ||
+                     format == FlyCapture2::PIXEL_FORMAT_RAW16);
+        bool luminance = ((format == FlyCapture2::PIXEL_FORMAT_RAW8 ||
+                           format == FlyCapture2::PIXEL_FORMAT_RAW16) &&
+                          m_cam.m_bayer_mode == BayerLuminance);
+
+        const unsigned char *src = image->GetData();
+        if (format == FlyCapture2::PIXEL_FORMAT_MONO12 || luminance || (wide && m_cam.m_y16_swap))
+        {
+            // unpacked, filtered or swapped first
+            m_acc_pixels.resize(nb_pixels * (wide ? 2 : 1));
+            _copyImage(*image, &m_acc_pixels[0], m_acc_pixels.size(), m_cam.m_y16_swap,
+                       false, luminance);
+            src = &m_acc_pixels[0];
+        }
+
+        if (wide)
+        {
+            // Mono12 is unpacked right aligned
+            unsigned short saturation = (format == FlyCapture2::PIXEL_FORMAT_MONO12) ? 0xfff : 0xffff;
+            m_acc_saturated += int(accumulate16((const unsigned short *) src, sum, nb_pixels,
+                                                first, saturation));
+        }
+        else
+            m_acc_saturated += int(accumulate8(src, sum, nb_pixels, first, 0xff));
+    }
+    else if (first)
+        memset(sum, 0, fDim.getMemSize());
+    if (timed)
+        m_cam.m_latency[CopyStage].record(LatencyHistogram::now() - t0);
+
+    if (pos < m_cam.m_acc_nb_frames - 1)
+        return;
+
+    m_cam.m_acc_last_saturated = m_acc_saturated;
+    if (m_acc_saturated)
+        m_cam.m_acc_saturated_frames++;
+
+    HwFrameInfoType frame_info;
+    frame_info.acq_frame_nb = acc_nb;
+    frame_info.frame_timestamp = m_acc_timestamp - m_cam.m_start_timestamp;
+    t0 = timed ? LatencyHistogram::now() : 0;
+    m_cam.m_dispatch_continue = buffer_mgr.newFrameReady(frame_info);
+    if (timed)
+        m_cam.m_latency[NewFrameReadyStage].record(LatencyHistogram::now() - t0);
+}
@@ -0,0 +1,135 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <math.h>
+#include <time.h>
+
+#include "PointGreyLatency.h"
+
+using namespace lima;
+using namespace lima::PointGrey;
+
+// lower bound of the first octave
+static const double MIN_DURATION = 1E-7;
+
+/*******************************************************************
+ * \brief LatencyHistogram constructor
+ *******************************************************************/
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void LatencyHistogram::record(double duration)
+{
+    int bin = 0;
+    double x = duration / MIN_DURATION;
+    if (x >= 1.)
+    {
+        int exp;
+        double mantissa = frexp(x, &exp);
+        bin = 1 + (exp - 1) * OCTAVE_BINS + int((2. * mantissa - 1.) * OCTAVE_BINS);
+        if (bin >= NB_BINS)
+            bin = NB_BINS - 1;
+    }
+
+    m_bins[bin]++;
+    if (!m_count || duration < m_min)
+        m_min = duration;
+    if (!m_count || duration > m_max)
+        m_max = duration;
+    m_count++;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void LatencyHistogram::reset()
+{
+    for (int i = 0; i < NB_BINS; ++i)
+        m_bins[i] = 0;
+    m_count = 0;
+    m_min = m_max = 0;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void LatencyHistogram::getSummary(int& count, double& min_value, double& p50,
+                                  double& p99, double& max_value) const
+{
+    count = m_count;
+    min_value = m_min;
+    max_value = m_max;
+    p50 = _percentile(0.5);
+    p99 = _percentile(0.99);
+}
+
+//-----------------------------------------------------
+// middle of the bin holding the percentile, within the
+// observed range
+//-----------------------------------------------------
+double LatencyHistogram::_percentile(double fraction) const
+{
+    unsigned int count = m_count;
+    if (!count)
+        return 0;
+
+    unsigned int rank = (unsigned int) ceil(fraction * count);
+    unsigned int sum = 0;
+    int bin = 0;
+    for (; bin < NB_BINS - 1; ++bin)
+    {
+        sum += m_bins[bin];
+        if (sum >= rank)
+            break;
+    }
+
+    double value;
+    if (bin == 0)
+        value = MIN_DURATION / 2;
+    else
+    {
+        int octave = (bin - 1) / OCTAVE_BINS;
+        int sub = (bin - 1) % OCTAVE_BINS;
+        value = ldexp(MIN_DURATION, octave) * (1. + (sub + 0.5) / OCTAVE_BINS);
+    }
+
+    if (value < m_min)
+        value = m_min;
+    if (value > m_max)
+        value = m_max;
+    return value;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+double LatencyHistogram::now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1E-9;
+}
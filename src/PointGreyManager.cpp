@@ -0,0 +1,285 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <stdio.h>
+#include <fstream>
+#include <map>
+
+#include "PointGreyManager.h"
+#include "PointGreyCamera.h"
+
+using namespace lima;
+using namespace lima::PointGrey;
+using namespace std;
+
+/*******************************************************************
+ * \brief Manager constructor
+ *******************************************************************/
+Manager::Manager()
+    : m_nb_bus_cameras(0)
+{
+    DEB_CONSTRUCTOR();
+
+    // the one bus enumeration
+    FlyCapture2::Error error = m_bus_manager.GetNumOfCameras(&m_nb_bus_cameras);
+    if (error != FlyCapture2::PGRERROR_OK)
+        THROW_HW_ERROR(Error) << "Failed to create bus manager: " << error.GetDescription();
+
+    if (m_nb_bus_cameras < 1)
+        THROW_HW_ERROR(Error) << "No cameras found";
+}
+
+Manager::~Manager()
+{
+    DEB_DESTRUCTOR();
+    for (vector<Entry>::iterator i = m_cameras.begin(); i != m_cameras.end(); ++i)
+        delete i->camera;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Manager::getNbBusCameras(int& nb_cameras)
+{
+    DEB_MEMBER_FUNCT();
+    nb_cameras = m_nb_bus_cameras;
+    DEB_RETURN() << DEB_VAR1(nb_cameras);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+Camera *Manager::addCamera(const int camera_serial,
+                           const int packet_size,
+                           const int packet_delay,
+                           const int nb_buffers,
+                           const Camera::GrabMode grab_mode,
+                           const int grab_timeout,
+                           const bool high_perf_retrieve,
+                           const std::string& acq_cpus,
+                           const Camera::SchedPolicy acq_policy,
+                           const int acq_priority)
+{
+    DEB_MEMBER_FUNCT();
+    DEB_PARAM() << DEB_VAR3(camera_serial, packet_size, packet_delay);
+
+    if (_find(camera_serial))
+        THROW_HW_ERROR(Error) << "Camera " << camera_serial << " already added";
+
+    Timestamp t0 = Timestamp::now();
+    FlyCapture2::PGRGuid pgrguid;
+    FlyCapture2::Error error = m_bus_manager.GetCameraFromSerialNumber(camera_serial, &pgrguid);
+    if (error != FlyCapture2::PGRERROR_OK)
+        THROW_HW_ERROR(Error) << "Camera not found: " << error.GetDescription();
+
+    FlyCapBackend *backend = new FlyCapBackend();
+    BackendGuard backend_guard(backend);
+    BackendError backend_error = backend->Connect(&pgrguid);
+    if (backend_error != FlyCapture2::PGRERROR_OK)
+        THROW_HW_ERROR(Error) << "Failed to connect to camera: " << backend_error.GetDescription();
+
+    Entry entry;
+    entry.serial = camera_serial;
+    double connect_time = Timestamp::now() - t0;
+    entry.camera = new Camera(backend, packet_size, packet_delay, nb_buffers, grab_mode,
+                              grab_timeout, high_perf_retrieve, acq_cpus, acq_policy,
+                              acq_priority);
+    backend_guard.release();
+    entry.camera->m_guid = Camera::_formatGuid(pgrguid);
+    entry.camera->m_connect_time = connect_time;
+    m_cameras.push_back(entry);
+    return entry.camera;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Manager::addCameras(const std::vector<int>& camera_serials)
+{
+    DEB_MEMBER_FUNCT();
+    for (vector<int>::const_iterator i = camera_serials.begin(); i != camera_serials.end(); ++i)
+        addCamera(*i);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+Camera *Manager::getCamera(const int camera_serial)
+{
+    DEB_MEMBER_FUNCT();
+    Entry *entry = _find(camera_serial);
+    if (!entry)
+        THROW_HW_ERROR(InvalidValue) << "Camera " << camera_serial << " not managed";
+    return entry->camera;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Manager::getNbCameras(int& nb_cameras)
+{
+    DEB_MEMBER_FUNCT();
+    nb_cameras = m_cameras.size();
+    DEB_RETURN() << DEB_VAR1(nb_cameras);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Manager::setCameraCpus(const int camera_serial, const std::string& cpus)
+{
+    DEB_MEMBER_FUNCT();
+    DEB_PARAM() << DEB_VAR2(camera_serial, cpus);
+    getCamera(camera_serial)->setAcqCpus(cpus);
+}
+
+//-----------------------------------------------------
+// all the cpus of a NUMA node, as listed by sysfs
+//-----------------------------------------------------
+void Manager::setCameraNode(const int camera_serial, const int node)
+{
+    DEB_MEMBER_FUNCT();
+    DEB_PARAM() << DEB_VAR2(camera_serial, node);
+
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+    ifstream file(path);
+    string cpus;
+    if (!file || !getline(file, cpus) || cpus.empty())
+        THROW_HW_ERROR(InvalidValue) << "No cpus found for NUMA node " << node;
+
+    getCamera(camera_serial)->setAcqCpus(cpus);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Manager::getNbNics(int& nb_nics)
+{
+    DEB_MEMBER_FUNCT();
+    vector<string> names;
+    vector<double> bandwidths;
+    _getNics(names, bandwidths);
+    nb_nics = names.size();
+    DEB_RETURN() << DEB_VAR1(nb_nics);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Manager::getNicBandwidth(const int nic, std::string& name, double& bandwidth)
+{
+    DEB_MEMBER_FUNCT();
+    DEB_PARAM() << DEB_VAR1(nic);
+
+    vector<string> names;
+    vector<double> bandwidths;
+    _getNics(names, bandwidths);
+    if (nic < 0 || nic >= int(names.size()))
+        THROW_HW_ERROR(InvalidValue) << "Invalid interface index " << nic;
+
+    name = names[nic];
+    bandwidth = bandwidths[nic];
+    DEB_RETURN() << DEB_VAR2(name, bandwidth);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Manager::setNicBandwidthBudget(const int nic, const double budget)
+{
+    DEB_MEMBER_FUNCT();
+    DEB_PARAM() << DEB_VAR2(nic, budget);
+
+    vector<string> names;
+    vector<double> bandwidths;
+    _getNics(names, bandwidths);
+    if (nic < 0 || nic >= int(names.size()))
+        THROW_HW_ERROR(InvalidValue) << "Invalid interface index " << nic;
+
+    vector<Camera *> cameras;
+    for (vector<Entry>::iterator i = m_cameras.begin(); i != m_cameras.end(); ++i)
+        if (_nicName(i->camera) == names[nic])
+            cameras.push_back(i->camera);
+
+    for (vector<Camera *>::iterator i = cameras.begin(); i != cameras.end(); ++i)
+    {
+        (*i)->setBandwidthBudget(budget / cameras.size());
+        bool auto_packet_delay;
+        (*i)->getAutoPacketDelay(auto_packet_delay);
+        if (budget > 0 && !auto_packet_delay)
+            (*i)->setAutoPacketDelay(true);
+    }
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+Manager::Entry *Manager::_find(const int camera_serial)
+{
+    for (vector<Entry>::iterator i = m_cameras.begin(); i != m_cameras.end(); ++i)
+        if (i->serial == camera_serial)
+            return &*i;
+    return NULL;
+}
+
+//-----------------------------------------------------
+// GigE cameras are grouped by subnet, one per interface
+// on a usual setup; other buses count as one interface
+//-----------------------------------------------------
+std::string Manager::_nicName(Camera *camera)
+{
+    const FlyCapture2::CameraInfo& info = camera->m_camera_info;
+    char name[64];
+    if (info.interfaceType == FlyCapture2::INTERFACE_GIGE)
+    {
+        const unsigned char *ip = info.ipAddress.octets;
+        const unsigned char *mask = info.subnetMask.octets;
+        snprintf(name, sizeof(name), "%d.%d.%d.%d",
+                 ip[0] & mask[0], ip[1] & mask[1], ip[2] & mask[2], ip[3] & mask[3]);
+    }
+    else
+        snprintf(name, sizeof(name), "bus%d", int(info.interfaceType));
+    return name;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Manager::_getNics(std::vector<std::string>& names, std::vector<double>& bandwidths)
+{
+    map<string, double> nics;
+    for (vector<Entry>::iterator i = m_cameras.begin(); i != m_cameras.end(); ++i)
+    {
+        double bandwidth;
+        i->camera->getAcqBandwidth(bandwidth);
+        nics[_nicName(i->camera)] += bandwidth;
+    }
+
+    names.clear();
+    bandwidths.clear();
+    for (map<string, double>::iterator i = nics.begin(); i != nics.end(); ++i)
+    {
+        names.push_back(i->first);
+        bandwidths.push_back(i->second);
+    }
+}
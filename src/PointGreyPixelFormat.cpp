@@ -0,0 +1,714 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include "PointGreyPixelFormat.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define POINTGREY_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+using namespace lima;
+using namespace lima::PointGrey;
+
+typedef void (*UnpackFunc)(const unsigned char *, unsigned short *, size_t);
+typedef void (*SwapFunc)(const unsigned char *, unsigned char *, size_t);
+
+//-----------------------------------------------------
+// Mono12 packed
+//
+// bytes  B0 B1 B2  ->  P0 = B0 << 4 | B1 & 0xf
+//                      P1 = B2 << 4 | B1 >> 4
+//-----------------------------------------------------
+static void _unpackMono12Scalar(const unsigned char *src, unsigned short *dst, size_t nb_pixels)
+{
+    size_t i = 0;
+    for (; i + 1 < nb_pixels; i += 2, src += 3)
+    {
+        dst[i] = (src[0] << 4) | (src[1] & 0xf);
+        dst[i + 1] = (src[2] << 4) | (src[1] >> 4);
+    }
+    if (i < nb_pixels)
+        dst[i] = (src[0] << 4) | (src[1] & 0xf);
+}
+
+#ifdef POINTGREY_X86_KERNELS
+// The shuffle builds B0:B1 words for even pixels and B2:B1 words
+// for odd ones, a shift and a lane mask then finish them:
+//   even = (w >> 4) & 0xff0 | w & 0xf,  odd = w >> 4
+#define MONO12_SHUFFLE 1, 0, 1, 2, 4, 3, 4, 5, 7, 6, 7, 8, 10, 9, 10, 11
+
+__attribute__((target("ssse3")))
+static void _unpackMono12Ssse3(const unsigned char *src, unsigned short *dst, size_t nb_pixels)
+{
+    const __m128i shuffle = _mm_setr_epi8(MONO12_SHUFFLE);
+    const __m128i high_mask = _mm_set1_epi32(0x0fff0ff0);
+    const __m128i low_mask = _mm_set1_epi32(0x0000000f);
+
+    // 8 pixels from 12 bytes, the 16 byte load must stay in the source
+    size_t i = 0;
+    for (; i + 11 <= nb_pixels; i += 8, src += 12, dst += 8)
+    {
+        __m128i w = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) src), shuffle);
+        __m128i p = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(w, 4), high_mask),
+                                 _mm_and_si128(w, low_mask));
+        _mm_storeu_si128((__m128i *) dst, p);
+    }
+    _unpackMono12Scalar(src, dst, nb_pixels - i);
+}
+
+__attribute__((target("avx2")))
+static void _unpackMono12Avx2(const unsigned char *src, unsigned short *dst, size_t nb_pixels)
+{
+    // the shuffle works within each 128 bit lane, one 12 byte group per lane
+    const __m256i shuffle = _mm256_setr_epi8(MONO12_SHUFFLE, MONO12_SHUFFLE);
+    const __m256i high_mask = _mm256_set1_epi32(0x0fff0ff0);
+    const __m256i low_mask = _mm256_set1_epi32(0x0000000f);
+
+    size_t i = 0;
+    for (; i + 19 <= nb_pixels; i += 16, src += 24, dst += 16)
+    {
+        __m256i b = _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *) src));
+        b = _mm256_inserti128_si256(b, _mm_loadu_si128((const __m128i *) (src + 12)), 1);
+        __m256i w = _mm256_shuffle_epi8(b, shuffle);
+        __m256i p = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi16(w, 4), high_mask),
+                                    _mm256_and_si256(w, low_mask));
+        _mm256_storeu_si256((__m256i *) dst, p);
+    }
+    _unpackMono12Scalar(src, dst, nb_pixels - i);
+}
+#endif
+
+//-----------------------------------------------------
+// 16 bit byte swap
+//-----------------------------------------------------
+static void _swapBytes16Scalar(const unsigned char *src, unsigned char *dst, size_t nb_pixels)
+{
+    const unsigned short *s = (const unsigned short *) src;
+    unsigned short *d = (unsigned short *) dst;
+    for (size_t i = 0; i < nb_pixels; ++i)
+        d[i] = (unsigned short) ((s[i] >> 8) | (s[i] << 8));
+}
+
+#ifdef POINTGREY_X86_KERNELS
+#define SWAP16_SHUFFLE 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14
+
+__attribute__((target("ssse3")))
+static void _swapBytes16Ssse3(const unsigned char *src, unsigned char *dst, size_t nb_pixels)
+{
+    const __m128i shuffle = _mm_setr_epi8(SWAP16_SHUFFLE);
+
+    size_t i = 0;
+    for (; i + 16 <= nb_pixels; i += 16, src += 32, dst += 32)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *) src);
+        __m128i b = _mm_loadu_si128((const __m128i *) (src + 16));
+        _mm_storeu_si128((__m128i *) dst, _mm_shuffle_epi8(a, shuffle));
+        _mm_storeu_si128((__m128i *) (dst + 16), _mm_shuffle_epi8(b, shuffle));
+    }
+    _swapBytes16Scalar(src, dst, nb_pixels - i);
+}
+
+__attribute__((target("avx2")))
+static void _swapBytes16Avx2(const unsigned char *src, unsigned char *dst, size_t nb_pixels)
+{
+    const __m256i shuffle = _mm256_setr_epi8(SWAP16_SHUFFLE, SWAP16_SHUFFLE);
+
+    size_t i = 0;
+    for (; i + 32 <= nb_pixels; i += 32, src += 64, dst += 64)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *) src);
+        __m256i b = _mm256_loadu_si256((const __m256i *) (src + 32));
+        _mm256_storeu_si256((__m256i *) dst, _mm256_shuffle_epi8(a, shuffle));
+        _mm256_storeu_si256((__m256i *) (dst + 32), _mm256_shuffle_epi8(b, shuffle));
+    }
+    _swapBytes16Scalar(src, dst, nb_pixels - i);
+}
+#endif
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+static UnpackFunc _selectMono12(const char **name)
+{
+#ifdef POINTGREY_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        *name = "avx2";
+        return _unpackMono12Avx2;
+    }
+    if (__builtin_cpu_supports("ssse3"))
+    {
+        *name = "ssse3";
+        return _unpackMono12Ssse3;
+    }
+#endif
+    *name = "scalar";
+    return _unpackMono12Scalar;
+}
+
+static SwapFunc _selectSwap16(const char **name)
+{
+#ifdef POINTGREY_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        *name = "avx2";
+        return _swapBytes16Avx2;
+    }
+    if (__builtin_cpu_supports("ssse3"))
+    {
+        *name = "ssse3";
+        return _swapBytes16Ssse3;
+    }
+#endif
+    *name = "scalar";
+    return _swapBytes16Scalar;
+}
+
+static const char *mono12_kernel_name = 0;
+static UnpackFunc mono12_kernel = _selectMono12(&mono12_kernel_name);
+static const char *swap16_kernel_name = 0;
+static SwapFunc swap16_kernel = _selectSwap16(&swap16_kernel_name);
+
+void lima::PointGrey::unpackMono12(const unsigned char *src, unsigned short *dst, size_t nb_pixels)
+{
+    mono12_kernel(src, dst, nb_pixels);
+}
+
+const char *lima::PointGrey::unpackMono12Kernel()
+{
+    return mono12_kernel_name;
+}
+
+void lima::PointGrey::swapBytes16(const unsigned char *src, unsigned char *dst, size_t nb_pixels)
+{
+    swap16_kernel(src, dst, nb_pixels);
+}
+
+const char *lima::PointGrey::swapBytes16Kernel()
+{
+    return swap16_kernel_name;
+}
+
+//-----------------------------------------------------
+// Bayer
+//-----------------------------------------------------
+enum { RED, GREEN, BLUE };
+
+// colour per tile row and column parity
+static const int bayer_colours[4][2][2] = {
+    {{RED, GREEN}, {GREEN, BLUE}},     // RGGB
+    {{GREEN, RED}, {BLUE, GREEN}},     // GRBG
+    {{GREEN, BLUE}, {RED, GREEN}},     // GBRG
+    {{BLUE, GREEN}, {GREEN, RED}},     // BGGR
+};
+
+// mirrored about the edge pixel, which keeps the Bayer parity
+static inline int _mirror(int i, int n)
+{
+    if (i < 0)
+        i = -i;
+    if (i >= n)
+        i = 2 * n - 2 - i;
+    return (i < 0 || i >= n) ? 0 : i;
+}
+
+// one demosaiced row
+struct BayerRow
+{
+    const unsigned char *up;
+    const unsigned char *cur;
+    const unsigned char *down;
+    unsigned char *dst;
+    int width;
+    // colour in this row other than green, at odd columns or not
+    int colour;
+    int colour_odd;
+};
+
+static void _demosaicRowScalar(const BayerRow& row, int x0, int x1)
+{
+    int other = 2 - row.colour;
+    for (int x = x0; x < x1; ++x)
+    {
+        int l = _mirror(x - 1, row.width);
+        int r = _mirror(x + 1, row.width);
+        int v[3];
+        if ((x & 1) == row.colour_odd)
+        {
+            v[row.colour] = row.cur[x];
+            v[GREEN] = (row.up[x] + row.down[x] + row.cur[l] + row.cur[r]) >> 2;
+            v[other] = (row.up[l] + row.up[r] + row.down[l] + row.down[r]) >> 2;
+        }
+        else
+        {
+            v[GREEN] = row.cur[x];
+            v[row.colour] = (row.cur[l] + row.cur[r]) >> 1;
+            v[other] = (row.up[x] + row.down[x]) >> 1;
+        }
+        unsigned char *d = row.dst + 3 * x;
+        d[0] = v[RED];
+        d[1] = v[GREEN];
+        d[2] = v[BLUE];
+    }
+}
+
+// returns the first column left to the scalar code, 0 when
+// the row is too short for it
+typedef int (*DemosaicRowFunc)(const BayerRow& row);
+
+static int _demosaicRowNone(const BayerRow&)
+{
+    return 0;
+}
+
+#ifdef POINTGREY_X86_KERNELS
+__attribute__((target("ssse3")))
+static inline __m128i _blend(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+// Interpolates one 8 pixel half, widened to 16 bit lanes. The
+// colour sample sits in the lanes of mask, green in the others.
+__attribute__((target("ssse3")))
+static inline void _demosaicHalf(__m128i mask,
+                                 __m128i a0, __m128i a1, __m128i a2,
+                                 __m128i b0, __m128i b1, __m128i b2,
+                                 __m128i c0, __m128i c1, __m128i c2,
+                                 __m128i& colour, __m128i& green, __m128i& other)
+{
+    __m128i cross = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(a1, c1), _mm_add_epi16(b0, b2)), 2);
+    __m128i diag = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(a0, a2), _mm_add_epi16(c0, c2)), 2);
+    __m128i vert = _mm_srli_epi16(_mm_add_epi16(a1, c1), 1);
+    __m128i horz = _mm_srli_epi16(_mm_add_epi16(b0, b2), 1);
+    colour = _blend(mask, b1, horz);
+    green = _blend(mask, cross, b1);
+    other = _blend(mask, diag, vert);
+}
+
+__attribute__((target("ssse3")))
+static int _demosaicRowSsse3(const BayerRow& row)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i mask = row.colour_odd ?
+        _mm_setr_epi16(0, -1, 0, -1, 0, -1, 0, -1) :
+        _mm_setr_epi16(-1, 0, -1, 0, -1, 0, -1, 0);
+
+    // byte k of the 48 byte output takes channel k % 3 of pixel k / 3
+    __m128i interleave[3][3];
+    for (int chunk = 0; chunk < 3; ++chunk)
+        for (int channel = 0; channel < 3; ++channel)
+        {
+            char m[16];
+            for (int k = 0; k < 16; ++k)
+            {
+                int g = 16 * chunk + k;
+                m[k] = (g % 3 == channel) ? char(g / 3) : char(0x80);
+            }
+            interleave[chunk][channel] = _mm_loadu_si128((const __m128i *) m);
+        }
+
+    // 16 pixels from x - 1 to x + 16, starting on an even column
+    int x = 2;
+    for (; x + 17 <= row.width; x += 16)
+    {
+        __m128i a[3], b[3], c[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            a[i] = _mm_loadu_si128((const __m128i *) (row.up + x - 1 + i));
+            b[i] = _mm_loadu_si128((const __m128i *) (row.cur + x - 1 + i));
+            c[i] = _mm_loadu_si128((const __m128i *) (row.down + x - 1 + i));
+        }
+
+        __m128i lo[3], hi[3];
+        _demosaicHalf(mask,
+                      _mm_unpacklo_epi8(a[0], zero), _mm_unpacklo_epi8(a[1], zero), _mm_unpacklo_epi8(a[2], zero),
+                      _mm_unpacklo_epi8(b[0], zero), _mm_unpacklo_epi8(b[1], zero), _mm_unpacklo_epi8(b[2], zero),
+                      _mm_unpacklo_epi8(c[0], zero), _mm_unpacklo_epi8(c[1], zero), _mm_unpacklo_epi8(c[2], zero),
+                      lo[0], lo[1], lo[2]);
+        _demosaicHalf(mask,
+                      _mm_unpackhi_epi8(a[0], zero), _mm_unpackhi_epi8(a[1], zero), _mm_unpackhi_epi8(a[2], zero),
+                      _mm_unpackhi_epi8(b[0], zero), _mm_unpackhi_epi8(b[1], zero), _mm_unpackhi_epi8(b[2], zero),
+                      _mm_unpackhi_epi8(c[0], zero), _mm_unpackhi_epi8(c[1], zero), _mm_unpackhi_epi8(c[2], zero),
+                      hi[0], hi[1], hi[2]);
+
+        __m128i planes[3];
+        planes[row.colour] = _mm_packus_epi16(lo[0], hi[0]);
+        planes[GREEN] = _mm_packus_epi16(lo[1], hi[1]);
+        planes[2 - row.colour] = _mm_packus_epi16(lo[2], hi[2]);
+
+        unsigned char *d = row.dst + 3 * x;
+        for (int chunk = 0; chunk < 3; ++chunk)
+        {
+            __m128i out = _mm_or_si128(_mm_shuffle_epi8(planes[RED], interleave[chunk][RED]),
+                          _mm_or_si128(_mm_shuffle_epi8(planes[GREEN], interleave[chunk][GREEN]),
+                                       _mm_shuffle_epi8(planes[BLUE], interleave[chunk][BLUE])));
+            _mm_storeu_si128((__m128i *) (d + 16 * chunk), out);
+        }
+    }
+    return x > 2 ? x : 0;
+}
+#endif
+
+static DemosaicRowFunc _selectDemosaic(const char **name)
+{
+#ifdef POINTGREY_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("ssse3"))
+    {
+        *name = "ssse3";
+        return _demosaicRowSsse3;
+    }
+#endif
+    *name = "scalar";
+    return _demosaicRowNone;
+}
+
+static const char *demosaic_kernel_name = 0;
+static DemosaicRowFunc demosaic_kernel = _selectDemosaic(&demosaic_kernel_name);
+
+void lima::PointGrey::demosaicRGB24(const unsigned char *src, unsigned char *dst,
+                                    int width, int height, int src_stride, BayerTile tile)
+{
+    for (int y = 0; y < height; ++y)
+    {
+        BayerRow row;
+        row.up = src + _mirror(y - 1, height) * src_stride;
+        row.cur = src + y * src_stride;
+        row.down = src + _mirror(y + 1, height) * src_stride;
+        row.dst = dst + size_t(y) * width * 3;
+        row.width = width;
+        const int *colours = bayer_colours[tile][y & 1];
+        row.colour_odd = (colours[0] == GREEN);
+        row.colour = colours[row.colour_odd];
+
+        // the SIMD kernel leaves both borders to the scalar code
+        int x = demosaic_kernel(row);
+        if (x)
+            _demosaicRowScalar(row, 0, 2);
+        _demosaicRowScalar(row, x, width);
+    }
+}
+
+const char *lima::PointGrey::demosaicKernel()
+{
+    return demosaic_kernel_name;
+}
+
+//-----------------------------------------------------
+// Bayer luminance, [1 2 1] filter on rows then columns
+//-----------------------------------------------------
+template <class T>
+static void _luminanceRowScalar(const T *up, const T *cur, const T *down, T *dst,
+                                int width, int x0, int x1)
+{
+    for (int x = x0; x < x1; ++x)
+    {
+        int l = _mirror(x - 1, width);
+        int r = _mirror(x + 1, width);
+        unsigned int a = up[l] + 2 * up[x] + up[r];
+        unsigned int b = cur[l] + 2 * cur[x] + cur[r];
+        unsigned int c = down[l] + 2 * down[x] + down[r];
+        dst[x] = (T) ((a + 2 * b + c + 8) >> 4);
+    }
+}
+
+typedef int (*Luminance8RowFunc)(const unsigned char *, const unsigned char *,
+                                 const unsigned char *, unsigned char *, int);
+typedef int (*Luminance16RowFunc)(const unsigned short *, const unsigned short *,
+                                  const unsigned short *, unsigned short *, int);
+
+template <class T>
+static int _luminanceRowNone(const T *, const T *, const T *, T *, int)
+{
+    return 0;
+}
+
+#ifdef POINTGREY_X86_KERNELS
+// Cascaded rounding averages, (l + r) / 2 then with the centre,
+// stay in 8 or 16 bit lanes
+__attribute__((target("sse2")))
+static int _luminance8RowSse2(const unsigned char *up, const unsigned char *cur,
+                              const unsigned char *down, unsigned char *dst, int width)
+{
+    int x = 1;
+    for (; x + 17 <= width; x += 16)
+    {
+        __m128i h[3];
+        const unsigned char *rows[3] = {up, cur, down};
+        for (int i = 0; i < 3; ++i)
+        {
+            __m128i l = _mm_loadu_si128((const __m128i *) (rows[i] + x - 1));
+            __m128i m = _mm_loadu_si128((const __m128i *) (rows[i] + x));
+            __m128i r = _mm_loadu_si128((const __m128i *) (rows[i] + x + 1));
+            h[i] = _mm_avg_epu8(_mm_avg_epu8(l, r), m);
+        }
+        _mm_storeu_si128((__m128i *) (dst + x), _mm_avg_epu8(_mm_avg_epu8(h[0], h[2]), h[1]));
+    }
+    return x > 1 ? x : 0;
+}
+
+__attribute__((target("sse2")))
+static int _luminance16RowSse2(const unsigned short *up, const unsigned short *cur,
+                               const unsigned short *down, unsigned short *dst, int width)
+{
+    int x = 1;
+    for (; x + 9 <= width; x += 8)
+    {
+        __m128i h[3];
+        const unsigned short *rows[3] = {up, cur, down};
+        for (int i = 0; i < 3; ++i)
+        {
+            __m128i l = _mm_loadu_si128((const __m128i *) (rows[i] + x - 1));
+            __m128i m = _mm_loadu_si128((const __m128i *) (rows[i] + x));
+            __m128i r = _mm_loadu_si128((const __m128i *) (rows[i] + x + 1));
+            h[i] = _mm_avg_epu16(_mm_avg_epu16(l, r), m);
+        }
+        _mm_storeu_si128((__m128i *) (dst + x), _mm_avg_epu16(_mm_avg_epu16(h[0], h[2]), h[1]));
+    }
+    return x > 1 ? x : 0;
+}
+
+static bool _hasSse2()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+}
+#endif
+
+#ifdef POINTGREY_X86_KERNELS
+static Luminance8RowFunc luminance8_kernel =
+    _hasSse2() ? _luminance8RowSse2 : _luminanceRowNone<unsigned char>;
+static Luminance16RowFunc luminance16_kernel =
+    _hasSse2() ? _luminance16RowSse2 : _luminanceRowNone<unsigned short>;
+#else
+static Luminance8RowFunc luminance8_kernel = _luminanceRowNone<unsigned char>;
+static Luminance16RowFunc luminance16_kernel = _luminanceRowNone<unsigned short>;
+#endif
+
+void lima::PointGrey::bayerLuminance8(const unsigned char *src, unsigned char *dst,
+                                      int width, int height, int src_stride)
+{
+    for (int y = 0; y < height; ++y)
+    {
+        const unsigned char *up = src + _mirror(y - 1, height) * src_stride;
+        const unsigned char *cur = src + y * src_stride;
+        const unsigned char *down = src + _mirror(y + 1, height) * src_stride;
+        unsigned char *d = dst + size_t(y) * width;
+
+        int x = luminance8_kernel(up, cur, down, d, width);
+        _luminanceRowScalar(up, cur, down, d, width, 0, x ? 1 : 0);
+        _luminanceRowScalar(up, cur, down, d, width, x, width);
+    }
+}
+
+void lima::PointGrey::bayerLuminance16(const unsigned short *src, unsigned short *dst,
+                                       int width, int height, int src_stride)
+{
+    const unsigned char *base = (const unsigned char *) src;
+    for (int y = 0; y < height; ++y)
+    {
+        const unsigned short *up = (const unsigned short *) (base + _mirror(y - 1, height) * src_stride);
+        const unsigned short *cur = (const unsigned short *) (base + y * src_stride);
+        const unsigned short *down = (const unsigned short *) (base + _mirror(y + 1, height) * src_stride);
+        unsigned short *d = dst + size_t(y) * width;
+
+        int x = luminance16_kernel(up, cur, down, d, width);
+        _luminanceRowScalar(up, cur, down, d, width, 0, x ? 1 : 0);
+        _luminanceRowScalar(up, cur, down, d, width, x, width);
+    }
+}
+
+//-----------------------------------------------------
+// Accumulation into 32 bit sums
+//-----------------------------------------------------
+typedef size_t (*Accumulate8Func)(const unsigned char *, unsigned int *, size_t,
+                                  bool, unsigned char);
+typedef size_t (*Accumulate16Func)(const unsigned short *, unsigned int *, size_t,
+                                   bool, unsigned short);
+
+template <class T>
+static size_t _accumulateScalar(const T *src, unsigned int *sum, size_t nb_pixels,
+                                bool first, T saturation)
+{
+    size_t saturated = 0;
+    for (size_t i = 0; i < nb_pixels; ++i)
+    {
+        saturated += (src[i] >= saturation);
+        sum[i] = first ? src[i] : sum[i] + src[i];
+    }
+    return saturated;
+}
+
+#ifdef POINTGREY_X86_KERNELS
+// a lane is saturated when saturation - pixel clamps to 0
+__attribute__((target("sse2")))
+static size_t _accumulate8Sse2(const unsigned char *src, unsigned int *sum, size_t nb_pixels,
+                               bool first, unsigned char saturation)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i sat = _mm_set1_epi8(char(saturation));
+
+    size_t saturated = 0;
+    size_t i = 0;
+    for (; i + 16 <= nb_pixels; i += 16, src += 16, sum += 16)
+    {
+        __m128i p = _mm_loadu_si128((const __m128i *) src);
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_subs_epu8(sat, p), zero));
+        saturated += __builtin_popcount(mask);
+
+        __m128i lo = _mm_unpacklo_epi8(p, zero);
+        __m128i hi = _mm_unpackhi_epi8(p, zero);
+        __m128i w[4] = {_mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero),
+                        _mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero)};
+        for (int k = 0; k < 4; ++k)
+        {
+            __m128i *s = (__m128i *) (sum + 4 * k);
+            _mm_storeu_si128(s, first ? w[k] : _mm_add_epi32(_mm_loadu_si128(s), w[k]));
+        }
+    }
+    return saturated + _accumulateScalar(src, sum, nb_pixels - i, first, saturation);
+}
+
+__attribute__((target("sse2")))
+static size_t _accumulate16Sse2(const unsigned short *src, unsigned int *sum, size_t nb_pixels,
+                                bool first, unsigned short saturation)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i sat = _mm_set1_epi16(short(saturation));
+
+    size_t saturated = 0;
+    size_t i = 0;
+    for (; i + 8 <= nb_pixels; i += 8, src += 8, sum += 8)
+    {
+        __m128i p = _mm_loadu_si128((const __m128i *) src);
+        // two mask bits per lane
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_subs_epu16(sat, p), zero));
+        saturated += __builtin_popcount(mask) / 2;
+
+        __m128i w[2] = {_mm_unpacklo_epi16(p, zero), _mm_unpackhi_epi16(p, zero)};
+        for (int k = 0; k < 2; ++k)
+        {
+            __m128i *s = (__m128i *) (sum + 4 * k);
+            _mm_storeu_si128(s, first ? w[k] : _mm_add_epi32(_mm_loadu_si128(s), w[k]));
+        }
+    }
+    return saturated + _accumulateScalar(src, sum, nb_pixels - i, first, saturation);
+}
+
+__attribute__((target("avx2")))
+static size_t _accumulate8Avx2(const unsigned char *src, unsigned int *sum, size_t nb_pixels,
+                               bool first, unsigned char saturation)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i sat = _mm256_set1_epi8(char(saturation));
+
+    size_t saturated = 0;
+    size_t i = 0;
+    for (; i + 32 <= nb_pixels; i += 32, src += 32, sum += 32)
+    {
+        __m256i p = _mm256_loadu_si256((const __m256i *) src);
+        unsigned int mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_subs_epu8(sat, p), zero));
+        saturated += __builtin_popcount(mask);
+
+        for (int k = 0; k < 4; ++k)
+        {
+            __m256i w = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) (src + 8 * k)));
+            __m256i *s = (__m256i *) (sum + 8 * k);
+            _mm256_storeu_si256(s, first ? w : _mm256_add_epi32(_mm256_loadu_si256(s), w));
+        }
+    }
+    return saturated + _accumulateScalar(src, sum, nb_pixels - i, first, saturation);
+}
+
+__attribute__((target("avx2")))
+static size_t _accumulate16Avx2(const unsigned short *src, unsigned int *sum, size_t nb_pixels,
+                                bool first, unsigned short saturation)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i sat = _mm256_set1_epi16(short(saturation));
+
+    size_t saturated = 0;
+    size_t i = 0;
+    for (; i + 16 <= nb_pixels; i += 16, src += 16, sum += 16)
+    {
+        __m256i p = _mm256_loadu_si256((const __m256i *) src);
+        unsigned int mask = _mm256_movemask_epi8(_mm256_cmpeq_epi16(_mm256_subs_epu16(sat, p), zero));
+        saturated += __builtin_popcount(mask) / 2;
+
+        for (int k = 0; k < 2; ++k)
+        {
+            __m256i w = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *) (src + 8 * k)));
+            __m256i *s = (__m256i *) (sum + 8 * k);
+            _mm256_storeu_si256(s, first ? w : _mm256_add_epi32(_mm256_loadu_si256(s), w));
+        }
+    }
+    return saturated + _accumulateScalar(src, sum, nb_pixels - i, first, saturation);
+}
+#endif
+
+static const char *_selectAccumulate(Accumulate8Func *func8, Accumulate16Func *func16)
+{
+#ifdef POINTGREY_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        *func8 = _accumulate8Avx2;
+        *func16 = _accumulate16Avx2;
+        return "avx2";
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        *func8 = _accumulate8Sse2;
+        *func16 = _accumulate16Sse2;
+        return "sse2";
+    }
+#endif
+    *func8 = _accumulateScalar<unsigned char>;
+    *func16 = _accumulateScalar<unsigned short>;
+    return "scalar";
+}
+
+static Accumulate8Func accumulate8_kernel = 0;
+static Accumulate16Func accumulate16_kernel = 0;
+static const char *accumulate_kernel_name =
+    _selectAccumulate(&accumulate8_kernel, &accumulate16_kernel);
+
+size_t lima::PointGrey::accumulate8(const unsigned char *src, unsigned int *sum,
+                                    size_t nb_pixels, bool first, unsigned char saturation)
+{
+    return accumulate8_kernel(src, sum, nb_pixels, first, saturation);
+}
+
+size_t lima::PointGrey::accumulate16(const unsigned short *src, unsigned int *sum,
+                                     size_t nb_pixels, bool first, unsigned short saturation)
+{
+    return accumulate16_kernel(src, sum, nb_pixels, first, saturation);
+}
+
+const char *lima::PointGrey::accumulateKernel()
+{
+    return accumulate_kernel_name;
+}
@@ -0,0 +1,808 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "PointGreySimBackend.h"
+#include "Timestamp.h"
+
+using namespace lima;
+using namespace lima::PointGrey;
+using namespace std;
+
+// image geometry constraints advertised by the simulated camera
+static const unsigned int OFFSET_H_STEP = 2;
+static const unsigned int OFFSET_V_STEP = 2;
+static const unsigned int IMAGE_H_STEP = 4;
+static const unsigned int IMAGE_V_STEP = 2;
+
+static const unsigned int SUPPORTED_PIXEL_FORMATS =
+    FlyCapture2::PIXEL_FORMAT_MONO8 | FlyCapture2::PIXEL_FORMAT_MONO12 |
+    FlyCapture2::PIXEL_FORMAT_MONO16 | FlyCapture2::PIXEL_FORMAT_RAW8 |
+    FlyCapture2::PIXEL_FORMAT_RAW16;
+
+// trigger source selecting the software trigger
+static const unsigned int SOFTWARE_TRIGGER_SOURCE = 7;
+
+// default number of frames kept by the simulated driver
+static const int DRIVER_BUFFERS = 10;
+
+static void _putEmbedded(unsigned char *data, unsigned int value)
+{
+    data[0] = (value >> 24) & 0xff;
+    data[1] = (value >> 16) & 0xff;
+    data[2] = (value >> 8) & 0xff;
+    data[3] = value & 0xff;
+}
+
+static unsigned int _getBitsPerPixel(FlyCapture2::PixelFormat format)
+{
+    switch (format)
+    {
+    case FlyCapture2::PIXEL_FORMAT_MONO8:
+    case FlyCapture2::PIXEL_FORMAT_RAW8:
+        return 8;
+    case FlyCapture2::PIXEL_FORMAT_MONO12:
+    case FlyCapture2::PIXEL_FORMAT_RAW12:
+        return 12;
+    case FlyCapture2::PIXEL_FORMAT_MONO16:
+    case FlyCapture2::PIXEL_FORMAT_RAW16:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+/*******************************************************************
+ * \brief SimBackend constructor
+ *******************************************************************/
+SimBackend::SimBackend(const int width,
+                       const int height,
+                       const double max_frame_rate,
+                       const bool color)
+    : m_width(width)
+    , m_height(height)
+    , m_max_frame_rate(max_frame_rate)
+    , m_consistency_rate(0)
+    , m_drop_rate(0)
+    , m_timeout_rate(0)
+    , m_seed(0)
+    , m_connected(true)
+    , m_capturing(false)
+    , m_next_frame_time(0)
+    , m_frame_counter(0)
+    , m_retrieved_frames(0)
+    , m_gap_after(0)
+    , m_gap_frames(0)
+    , m_pending_triggers(0)
+    , m_trigger_frame_time(0)
+    , m_epoch(Timestamp::now())
+{
+    DEB_CONSTRUCTOR();
+    DEB_PARAM() << DEB_VAR4(width, height, max_frame_rate, color);
+
+    strncpy(m_camera_info.vendorName, "Point Grey Research", sizeof(m_camera_info.vendorName) - 1);
+    strncpy(m_camera_info.modelName, "Simulated camera", sizeof(m_camera_info.modelName) - 1);
+    m_camera_info.isColorCamera = color;
+    m_camera_info.bayerTileFormat = color ? FlyCapture2::RGGB : FlyCapture2::NONE;
+
+    _addProperty(FlyCapture2::SHUTTER, 0.01, 1000., 10.);
+    _addProperty(FlyCapture2::GAIN, 0., 24., 0.);
+    _addProperty(FlyCapture2::FRAME_RATE, 1., max_frame_rate, max_frame_rate);
+
+    memset(&m_trigger_mode, 0, sizeof(m_trigger_mode));
+
+    m_config.numBuffers = DRIVER_BUFFERS;
+    m_config.grabMode = FlyCapture2::DROP_FRAMES;
+    m_config.grabTimeout = FlyCapture2::TIMEOUT_INFINITE;
+    m_config.highPerformanceRetrieveBuffer = false;
+
+    memset(&m_embedded_info, 0, sizeof(m_embedded_info));
+    m_embedded_info.timestamp.available = true;
+    m_embedded_info.frameCounter.available = true;
+    memset(&m_last_timestamp, 0, sizeof(m_last_timestamp));
+    memset(&m_last_metadata, 0, sizeof(m_last_metadata));
+
+    // image data format, bit 0 selects the little endian Y16
+    m_registers[0x1048] = 0x80000001;
+    // software trigger, bit 31 clear when ready for a trigger
+    m_registers[0x62c] = 0;
+
+#ifdef USE_GIGE
+    m_bin_x = m_bin_y = 1;
+    m_gige_properties[FlyCapture2::PACKET_SIZE] = 1400;
+    m_gige_properties[FlyCapture2::PACKET_DELAY] = 400;
+#else
+    m_image_settings.mode = FlyCapture2::MODE_0;
+#endif
+    m_image_settings.offsetX = 0;
+    m_image_settings.offsetY = 0;
+    m_image_settings.width = width;
+    m_image_settings.height = height;
+    m_image_settings.pixelFormat = FlyCapture2::PIXEL_FORMAT_MONO8;
+
+    // Static gradient, the frames are copied out of it like out
+    // of the driver buffers
+    m_pattern.resize(size_t(width) * height * 2);
+    for (size_t i = 0; i < m_pattern.size(); ++i)
+        m_pattern[i] = (unsigned char) (i + i / width);
+}
+
+SimBackend::~SimBackend()
+{
+    DEB_DESTRUCTOR();
+}
+
+//-----------------------------------------------------
+// simulation control
+//-----------------------------------------------------
+void SimBackend::getErrorRates(double& consistency_rate, double& drop_rate, double& timeout_rate)
+{
+    DEB_MEMBER_FUNCT();
+    AutoMutex lock(m_cond.mutex());
+    consistency_rate = m_consistency_rate;
+    drop_rate = m_drop_rate;
+    timeout_rate = m_timeout_rate;
+    DEB_RETURN() << DEB_VAR3(consistency_rate, drop_rate, timeout_rate);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void SimBackend::setErrorRates(double consistency_rate, double drop_rate, double timeout_rate)
+{
+    DEB_MEMBER_FUNCT();
+    DEB_PARAM() << DEB_VAR3(consistency_rate, drop_rate, timeout_rate);
+    AutoMutex lock(m_cond.mutex());
+    m_consistency_rate = consistency_rate;
+    m_drop_rate = drop_rate;
+    m_timeout_rate = timeout_rate;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void SimBackend::getFrameCounter(int& frame_counter)
+{
+    DEB_MEMBER_FUNCT();
+    AutoMutex lock(m_cond.mutex());
+    frame_counter = m_frame_counter;
+    DEB_RETURN() << DEB_VAR1(frame_counter);
+}
+
+//-----------------------------------------------------
+// connection
+//-----------------------------------------------------
+BackendError SimBackend::Disconnect()
+{
+    StopCapture();
+    m_connected = false;
+    return BackendError();
+}
+
+BackendError SimBackend::GetCameraInfo(FlyCapture2::CameraInfo* pCameraInfo)
+{
+    *pCameraInfo = m_camera_info;
+    return BackendError();
+}
+
+//-----------------------------------------------------
+// stream configuration, the buffer count and grab mode
+// shape how frames are lost when retrieval lags behind
+//-----------------------------------------------------
+BackendError SimBackend::GetConfiguration(FlyCapture2::FC2Config* pConfig)
+{
+    AutoMutex lock(m_cond.mutex());
+    *pConfig = m_config;
+    return BackendError();
+}
+
+BackendError SimBackend::SetConfiguration(const FlyCapture2::FC2Config* pConfig)
+{
+    AutoMutex lock(m_cond.mutex());
+    if (m_capturing)
+        return BackendError(FlyCapture2::PGRERROR_ISOCH_ALREADY_STARTED, "Isoch already started");
+    if (pConfig->numBuffers < 1 ||
+        (pConfig->grabTimeout < 0 && pConfig->grabTimeout != FlyCapture2::TIMEOUT_INFINITE))
+        return BackendError(FlyCapture2::PGRERROR_INVALID_PARAMETER, "Invalid configuration");
+
+    m_config.numBuffers = pConfig->numBuffers;
+    if (pConfig->grabMode != FlyCapture2::UNSPECIFIED_GRAB_MODE)
+        m_config.grabMode = pConfig->grabMode;
+    m_config.grabTimeout = pConfig->grabTimeout;
+    m_config.highPerformanceRetrieveBuffer = pConfig->highPerformanceRetrieveBuffer;
+    return BackendError();
+}
+
+//-----------------------------------------------------
+// capture
+//-----------------------------------------------------
+BackendError SimBackend::StartCapture()
+{
+    AutoMutex lock(m_cond.mutex());
+    if (!m_connected)
+        return BackendError(FlyCapture2::PGRERROR_NOT_CONNECTED, "Camera is not connected");
+    if (m_capturing)
+        return BackendError(FlyCapture2::PGRERROR_ISOCH_ALREADY_STARTED, "Isoch already started");
+
+    m_capturing = true;
+    m_next_frame_time = double(Timestamp::now()) + _getFramePeriod();
+    m_gap_after = m_gap_frames = 0;
+    m_pending_triggers = 0;
+    return BackendError();
+}
+
+BackendError SimBackend::StopCapture()
+{
+    AutoMutex lock(m_cond.mutex());
+    if (!m_capturing)
+        return BackendError(FlyCapture2::PGRERROR_ISOCH_NOT_STARTED, "Isoch not started");
+
+    m_capturing = false;
+    m_cond.broadcast();
+    return BackendError();
+}
+
+BackendError SimBackend::RetrieveBuffer(FlyCapture2::Image* pImage)
+{
+    AutoMutex lock(m_cond.mutex());
+    double frame_time;
+    double deadline = -1;
+    if (m_config.grabTimeout != FlyCapture2::TIMEOUT_INFINITE)
+        deadline = double(Timestamp::now()) + m_config.grabTimeout * 1E-3;
+    while (true)
+    {
+        if (!m_capturing)
+            return BackendError(FlyCapture2::PGRERROR_ISOCH_NOT_STARTED, "Isoch not started");
+
+        // the software trigger is the only trigger input of a
+        // simulated camera, wait for ever on the others
+        double now = Timestamp::now();
+        double wait_until = m_next_frame_time;
+        if (m_trigger_mode.onOff)
+            wait_until = m_pending_triggers ? m_trigger_frame_time : -1;
+        if (wait_until < 0 || now < wait_until)
+        {
+            if (deadline >= 0 && (wait_until < 0 || deadline < wait_until))
+            {
+                if (now >= deadline)
+                    return BackendError(FlyCapture2::PGRERROR_TIMEOUT, "Timeout");
+                wait_until = deadline;
+            }
+            if (wait_until < 0)
+                m_cond.wait();
+            else
+                m_cond.wait(wait_until - now);
+            continue;
+        }
+
+        if (m_trigger_mode.onOff)
+        {
+            frame_time = m_trigger_frame_time;
+            m_pending_triggers--;
+            m_frame_counter++;
+        }
+        else if (!_nextFrame(now, frame_time))
+            continue;
+
+        if (_draw(m_drop_rate))
+            // lost on the link, wait for the next one
+            continue;
+        if (_draw(m_timeout_rate))
+            return BackendError(FlyCapture2::PGRERROR_TIMEOUT, "Timeout (simulated)");
+        if (_draw(m_consistency_rate))
+            return BackendError(FlyCapture2::PGRERROR_IMAGE_CONSISTENCY_ERROR,
+                                "Image consistency error (simulated)");
+        break;
+    }
+
+    _fillImage(pImage, frame_time);
+    m_retrieved_frames++;
+    return BackendError();
+}
+
+//-----------------------------------------------------
+// properties
+//-----------------------------------------------------
+BackendError SimBackend::GetPropertyInfo(FlyCapture2::PropertyInfo* pPropInfo)
+{
+    AutoMutex lock(m_cond.mutex());
+    std::map<int, FlyCapture2::PropertyInfo>::iterator i = m_property_infos.find(pPropInfo->type);
+    if (i == m_property_infos.end())
+    {
+        pPropInfo->present = false;
+        return BackendError();
+    }
+    *pPropInfo = i->second;
+    return BackendError();
+}
+
+BackendError SimBackend::GetProperty(FlyCapture2::Property* pProp)
+{
+    AutoMutex lock(m_cond.mutex());
+    std::map<int, FlyCapture2::Property>::iterator i = m_properties.find(pProp->type);
+    if (i == m_properties.end())
+        return BackendError(FlyCapture2::PGRERROR_PROPERTY_NOT_PRESENT, "Property not present");
+    *pProp = i->second;
+    return BackendError();
+}
+
+BackendError SimBackend::SetProperty(const FlyCapture2::Property* pProp)
+{
+    AutoMutex lock(m_cond.mutex());
+    std::map<int, FlyCapture2::PropertyInfo>::iterator i = m_property_infos.find(pProp->type);
+    if (i == m_property_infos.end())
+        return BackendError(FlyCapture2::PGRERROR_PROPERTY_NOT_PRESENT, "Property not present");
+
+    FlyCapture2::Property& property = m_properties[pProp->type];
+    property.onOff = pProp->onOff;
+    property.autoManualMode = pProp->autoManualMode;
+    if (pProp->absControl && !pProp->autoManualMode)
+    {
+        float value = pProp->absValue;
+        if (value < i->second.absMin)
+            value = i->second.absMin;
+        if (value > i->second.absMax)
+            value = i->second.absMax;
+        property.absValue = value;
+    }
+    return BackendError();
+}
+
+//-----------------------------------------------------
+// trigger
+//-----------------------------------------------------
+BackendError SimBackend::GetTriggerModeInfo(FlyCapture2::TriggerModeInfo* pTriggerModeInfo)
+{
+    memset(pTriggerModeInfo, 0, sizeof(*pTriggerModeInfo));
+    pTriggerModeInfo->present = true;
+    pTriggerModeInfo->onOffSupported = true;
+    pTriggerModeInfo->polaritySupported = true;
+    pTriggerModeInfo->valueReadable = true;
+    pTriggerModeInfo->sourceMask = 0xf;
+    pTriggerModeInfo->softwareTriggerSupported = true;
+    // IIDC inquiry layout: mode n is bit (15 - n), modes 0, 1
+    // and 15 (multi-shot)
+    pTriggerModeInfo->modeMask = (1 << 15) | (1 << 14) | (1 << 0);
+    return BackendError();
+}
+
+BackendError SimBackend::GetTriggerMode(FlyCapture2::TriggerMode* pTriggerMode)
+{
+    AutoMutex lock(m_cond.mutex());
+    *pTriggerMode = m_trigger_mode;
+    return BackendError();
+}
+
+BackendError SimBackend::SetTriggerMode(const FlyCapture2::TriggerMode* pTriggerMode)
+{
+    AutoMutex lock(m_cond.mutex());
+    m_trigger_mode = *pTriggerMode;
+    m_pending_triggers = 0;
+    m_cond.broadcast();
+    return BackendError();
+}
+
+BackendError SimBackend::FireSoftwareTrigger()
+{
+    AutoMutex lock(m_cond.mutex());
+    if (!m_capturing)
+        return BackendError(FlyCapture2::PGRERROR_ISOCH_NOT_STARTED, "Isoch not started");
+    if (!m_trigger_mode.onOff || m_trigger_mode.source != SOFTWARE_TRIGGER_SOURCE)
+        return BackendError(FlyCapture2::PGRERROR_FAILED, "Software trigger not selected");
+
+    // the frame is ready once exposed
+    FlyCapture2::Property& shutter = m_properties[FlyCapture2::SHUTTER];
+    double now = Timestamp::now();
+    if (!m_pending_triggers || m_trigger_frame_time < now)
+        m_trigger_frame_time = now;
+    m_trigger_frame_time += shutter.absValue * 1E-3;
+    m_pending_triggers++;
+    m_cond.broadcast();
+    return BackendError();
+}
+
+//-----------------------------------------------------
+// registers
+//-----------------------------------------------------
+BackendError SimBackend::ReadRegister(unsigned int address, unsigned int* pValue)
+{
+    AutoMutex lock(m_cond.mutex());
+    std::map<unsigned int, unsigned int>::iterator i = m_registers.find(address);
+    if (i == m_registers.end())
+        return BackendError(FlyCapture2::PGRERROR_READ_REGISTER_FAILED, "Register not implemented");
+    *pValue = i->second;
+    return BackendError();
+}
+
+BackendError SimBackend::WriteRegister(unsigned int address, unsigned int value)
+{
+    AutoMutex lock(m_cond.mutex());
+    std::map<unsigned int, unsigned int>::iterator i = m_registers.find(address);
+    if (i == m_registers.end())
+        return BackendError(FlyCapture2::PGRERROR_WRITE_REGISTER_FAILED, "Register not implemented");
+    i->second = value;
+    return BackendError();
+}
+
+//-----------------------------------------------------
+// statistics
+//-----------------------------------------------------
+BackendError SimBackend::GetStats(FlyCapture2::CameraStats* pStats)
+{
+    AutoMutex lock(m_cond.mutex());
+    memset(pStats, 0, sizeof(*pStats));
+    pStats->imageDropped = m_frame_counter - m_retrieved_frames;
+    // 40 C, in tenths of kelvin
+    pStats->temperature = 3132;
+    return BackendError();
+}
+
+//-----------------------------------------------------
+// embedded image information
+//-----------------------------------------------------
+BackendError SimBackend::GetEmbeddedImageInfo(FlyCapture2::EmbeddedImageInfo* pInfo)
+{
+    AutoMutex lock(m_cond.mutex());
+    *pInfo = m_embedded_info;
+    return BackendError();
+}
+
+BackendError SimBackend::SetEmbeddedImageInfo(FlyCapture2::EmbeddedImageInfo* pInfo)
+{
+    AutoMutex lock(m_cond.mutex());
+    m_embedded_info.timestamp.onOff = pInfo->timestamp.onOff && m_embedded_info.timestamp.available;
+    m_embedded_info.frameCounter.onOff = pInfo->frameCounter.onOff && m_embedded_info.frameCounter.available;
+    return BackendError();
+}
+
+BackendError SimBackend::GetImageMetadata(const FlyCapture2::Image* pImage,
+                                          FlyCapture2::TimeStamp* pTimeStamp,
+                                          FlyCapture2::ImageMetadata* pMetadata)
+{
+    AutoMutex lock(m_cond.mutex());
+    *pTimeStamp = m_last_timestamp;
+    *pMetadata = m_last_metadata;
+    return BackendError();
+}
+
+//-----------------------------------------------------
+// image settings
+//-----------------------------------------------------
+#ifdef USE_GIGE
+BackendError SimBackend::GetGigEImageSettingsInfo(ImageSettingsInfo_t* pInfo)
+{
+    memset(pInfo, 0, sizeof(*pInfo));
+    _getMaxSize(pInfo->maxWidth, pInfo->maxHeight);
+    pInfo->offsetHStepSize = OFFSET_H_STEP;
+    pInfo->offsetVStepSize = OFFSET_V_STEP;
+    pInfo->imageHStepSize = IMAGE_H_STEP;
+    pInfo->imageVStepSize = IMAGE_V_STEP;
+    pInfo->pixelFormatBitField = SUPPORTED_PIXEL_FORMATS;
+    return BackendError();
+}
+
+BackendError SimBackend::GetGigEImageSettings(ImageSettings_t* pSettings)
+{
+    AutoMutex lock(m_cond.mutex());
+    *pSettings = m_image_settings;
+    return BackendError();
+}
+
+BackendError SimBackend::SetGigEImageSettings(const ImageSettings_t* pSettings)
+{
+    AutoMutex lock(m_cond.mutex());
+    if (m_capturing)
+        return BackendError(FlyCapture2::PGRERROR_ISOCH_ALREADY_STARTED, "Isoch already started");
+    if (!_checkImageSettings(*pSettings))
+        return BackendError(FlyCapture2::PGRERROR_INVALID_SETTINGS, "Invalid image settings");
+    m_image_settings = *pSettings;
+    return BackendError();
+}
+
+BackendError SimBackend::GetGigEImageBinningSettings(unsigned int* pHorzBinnningValue,
+                                                     unsigned int* pVertBinnningValue)
+{
+    *pHorzBinnningValue = m_bin_x;
+    *pVertBinnningValue = m_bin_y;
+    return BackendError();
+}
+
+BackendError SimBackend::SetGigEImageBinningSettings(unsigned int horzBinnningValue,
+                                                     unsigned int vertBinnningValue)
+{
+    AutoMutex lock(m_cond.mutex());
+    if (m_capturing)
+        return BackendError(FlyCapture2::PGRERROR_ISOCH_ALREADY_STARTED, "Isoch already started");
+    if ((horzBinnningValue != 1 && horzBinnningValue != 2 && horzBinnningValue != 4) ||
+        (vertBinnningValue != 1 && vertBinnningValue != 2 && vertBinnningValue != 4))
+        return BackendError(FlyCapture2::PGRERROR_INVALID_PARAMETER, "Unsupported binning");
+
+    m_bin_x = horzBinnningValue;
+    m_bin_y = vertBinnningValue;
+
+    // the camera falls back to the full binned frame
+    m_image_settings.offsetX = m_image_settings.offsetY = 0;
+    _getMaxSize(m_image_settings.width, m_image_settings.height);
+    return BackendError();
+}
+
+BackendError SimBackend::DiscoverGigEPacketSize(unsigned int* pPacketSize)
+{
+    // a jumbo frame path
+    *pPacketSize = 9000;
+    return BackendError();
+}
+
+BackendError SimBackend::GetGigEProperty(FlyCapture2::GigEProperty* pGigEProp)
+{
+    AutoMutex lock(m_cond.mutex());
+    std::map<int, unsigned int>::iterator i = m_gige_properties.find(pGigEProp->propType);
+    if (i == m_gige_properties.end())
+        return BackendError(FlyCapture2::PGRERROR_PROPERTY_NOT_PRESENT, "Property not present");
+    pGigEProp->isReadable = pGigEProp->isWritable = true;
+    pGigEProp->min = 0;
+    pGigEProp->max = pGigEProp->propType == FlyCapture2::PACKET_SIZE ? 9000 : 6250;
+    pGigEProp->value = i->second;
+    return BackendError();
+}
+
+BackendError SimBackend::SetGigEProperty(const FlyCapture2::GigEProperty* pGigEProp)
+{
+    AutoMutex lock(m_cond.mutex());
+    std::map<int, unsigned int>::iterator i = m_gige_properties.find(pGigEProp->propType);
+    if (i == m_gige_properties.end())
+        return BackendError(FlyCapture2::PGRERROR_PROPERTY_NOT_PRESENT, "Property not present");
+    i->second = pGigEProp->value;
+    return BackendError();
+}
+#else
+BackendError SimBackend::GetFormat7Info(ImageSettingsInfo_t* pInfo, bool* pSupported)
+{
+    FlyCapture2::Mode mode = pInfo->mode;
+    memset(pInfo, 0, sizeof(*pInfo));
+    pInfo->mode = mode;
+
+    // mode 0 is the full frame, mode 1 the 2x2 binned one
+    *pSupported = (mode == FlyCapture2::MODE_0 || mode == FlyCapture2::MODE_1);
+    if (!*pSupported)
+        return BackendError();
+
+    unsigned int bin = (mode == FlyCapture2::MODE_1) ? 2 : 1;
+    pInfo->maxWidth = m_width / bin;
+    pInfo->maxHeight = m_height / bin;
+    pInfo->offsetHStepSize = OFFSET_H_STEP;
+    pInfo->offsetVStepSize = OFFSET_V_STEP;
+    pInfo->imageHStepSize = IMAGE_H_STEP;
+    pInfo->imageVStepSize = IMAGE_V_STEP;
+    pInfo->pixelFormatBitField = SUPPORTED_PIXEL_FORMATS;
+    return BackendError();
+}
+
+BackendError SimBackend::ValidateFormat7Settings(const ImageSettings_t* pSettings,
+                                                 bool* pSettingsAreValid,
+                                                 FlyCapture2::Format7PacketInfo* pPacketInfo)
+{
+    AutoMutex lock(m_cond.mutex());
+    *pSettingsAreValid = _checkImageSettings(*pSettings);
+    pPacketInfo->recommendedBytesPerPacket = 8192;
+    pPacketInfo->maxBytesPerPacket = 8192;
+    pPacketInfo->unitBytesPerPacket = 4;
+    return BackendError();
+}
+
+BackendError SimBackend::GetFormat7Configuration(ImageSettings_t* pSettings,
+                                                 unsigned int* pPacketSize,
+                                                 float* pPercentage)
+{
+    AutoMutex lock(m_cond.mutex());
+    *pSettings = m_image_settings;
+    *pPacketSize = 8192;
+    *pPercentage = 100.;
+    return BackendError();
+}
+
+BackendError SimBackend::SetFormat7Configuration(const ImageSettings_t* pSettings,
+                                                 unsigned int packetSize)
+{
+    AutoMutex lock(m_cond.mutex());
+    if (m_capturing)
+        return BackendError(FlyCapture2::PGRERROR_ISOCH_ALREADY_STARTED, "Isoch already started");
+    if (!_checkImageSettings(*pSettings))
+        return BackendError(FlyCapture2::PGRERROR_INVALID_SETTINGS, "Invalid image settings");
+    m_image_settings = *pSettings;
+    return BackendError();
+}
+#endif
+
+//-----------------------------------------------------
+// helpers
+//-----------------------------------------------------
+bool SimBackend::_nextFrame(double now, double& frame_time)
+{
+    // false when the frames lost in BUFFER_FRAMES mode are skipped
+    double period = _getFramePeriod();
+    int nb_buffers = m_config.numBuffers;
+    if (m_gap_frames && !m_gap_after)
+    {
+        // buffered frames all retrieved, then come the lost ones
+        m_frame_counter += m_gap_frames;
+        m_next_frame_time += m_gap_frames * period;
+        m_gap_frames = 0;
+        return false;
+    }
+    int backlog = int((now - m_next_frame_time) / period) - m_gap_frames;
+    if (backlog >= nb_buffers)
+    {
+        int lost = backlog - nb_buffers + 1;
+        if (m_config.grabMode == FlyCapture2::BUFFER_FRAMES)
+        {
+            // the oldest frames are kept, the newest are lost
+            if (!m_gap_frames)
+                m_gap_after = nb_buffers;
+            m_gap_frames += lost;
+        }
+        else
+        {
+            // only the most recent frames are kept
+            m_frame_counter += lost;
+            m_next_frame_time += lost * period;
+        }
+    }
+    if (m_gap_after)
+        m_gap_after--;
+    frame_time = m_next_frame_time;
+    m_next_frame_time += period;
+    m_frame_counter++;
+    return true;
+}
+
+void SimBackend::_addProperty(FlyCapture2::PropertyType type,
+                              float min_value, float max_value, float value)
+{
+    FlyCapture2::PropertyInfo info(type);
+    info.present = true;
+    info.autoSupported = true;
+    info.manualSupported = true;
+    info.onOffSupported = true;
+    info.absValSupported = true;
+    info.readOutSupported = true;
+    info.absMin = min_value;
+    info.absMax = max_value;
+    m_property_infos[type] = info;
+
+    FlyCapture2::Property property(type);
+    property.present = true;
+    property.absControl = true;
+    property.onOff = true;
+    property.autoManualMode = false;
+    property.absValue = value;
+    m_properties[type] = property;
+}
+
+void SimBackend::_getMaxSize(unsigned int& width, unsigned int& height)
+{
+#ifdef USE_GIGE
+    width = m_width / m_bin_x;
+    height = m_height / m_bin_y;
+#else
+    unsigned int bin = (m_image_settings.mode == FlyCapture2::MODE_1) ? 2 : 1;
+    width = m_width / bin;
+    height = m_height / bin;
+#endif
+}
+
+bool SimBackend::_checkImageSettings(const ImageSettings_t& settings)
+{
+#ifndef USE_GIGE
+    if (settings.mode != FlyCapture2::MODE_0 && settings.mode != FlyCapture2::MODE_1)
+        return false;
+    unsigned int bin = (settings.mode == FlyCapture2::MODE_1) ? 2 : 1;
+    unsigned int max_width = m_width / bin, max_height = m_height / bin;
+#else
+    unsigned int max_width, max_height;
+    _getMaxSize(max_width, max_height);
+#endif
+    if (!(settings.pixelFormat & SUPPORTED_PIXEL_FORMATS))
+        return false;
+    if (!settings.width || !settings.height ||
+        settings.offsetX + settings.width > max_width ||
+        settings.offsetY + settings.height > max_height)
+        return false;
+    if (settings.offsetX % OFFSET_H_STEP || settings.offsetY % OFFSET_V_STEP)
+        return false;
+    // the full frame is always accepted
+    if ((settings.width % IMAGE_H_STEP && settings.width != max_width) ||
+        (settings.height % IMAGE_V_STEP && settings.height != max_height))
+        return false;
+    return true;
+}
+
+double SimBackend::_getFramePeriod()
+{
+    const FlyCapture2::Property& frame_rate = m_properties[FlyCapture2::FRAME_RATE];
+    const FlyCapture2::Property& shutter = m_properties[FlyCapture2::SHUTTER];
+
+    double rate = m_max_frame_rate;
+    if (frame_rate.onOff && !frame_rate.autoManualMode && frame_rate.absValue > 0)
+        rate = frame_rate.absValue;
+
+    double period = 1. / rate;
+    double exposure = shutter.absValue * 1E-3;
+    return (exposure > period) ? exposure : period;
+}
+
+bool SimBackend::_draw(double rate)
+{
+    return (rate > 0) && (rand_r(&m_seed) < rate * RAND_MAX);
+}
+
+void SimBackend::_fillImage(FlyCapture2::Image* pImage, double frame_time)
+{
+    FlyCapture2::PixelFormat format = m_image_settings.pixelFormat;
+    unsigned int cols = m_image_settings.width;
+    unsigned int rows = m_image_settings.height;
+    unsigned int stride = cols * _getBitsPerPixel(format) / 8;
+    unsigned int size = stride * rows;
+    FlyCapture2::BayerTileFormat bayer = FlyCapture2::NONE;
+    if (format == FlyCapture2::PIXEL_FORMAT_RAW8 || format == FlyCapture2::PIXEL_FORMAT_RAW16)
+        bayer = m_camera_info.bayerTileFormat;
+
+    if (pImage->GetData() && pImage->GetDataSize() >= size)
+    {
+        // user buffer attached, fill it in place
+        pImage->SetDimensions(rows, cols, stride, format, bayer);
+        memcpy(pImage->GetData(), &m_pattern[0], size);
+    }
+    else
+    {
+        FlyCapture2::Image frame(rows, cols, stride, &m_pattern[0], size, format, bayer);
+        pImage->DeepCopy(&frame);
+    }
+
+    // 1394 cycle time of the start of the frame: 128 s wrapping
+    // seconds, 8 kHz cycles and 24.576 MHz offsets
+    double t = frame_time - m_epoch;
+    unsigned int ticks = (unsigned int) (fmod(t, 128.) * 8000. * 3072.);
+    m_last_timestamp.seconds = (long long) frame_time;
+    m_last_timestamp.microSeconds = (unsigned int) ((frame_time - floor(frame_time)) * 1E6);
+    m_last_timestamp.cycleSeconds = ticks / (8000 * 3072);
+    m_last_timestamp.cycleCount = (ticks / 3072) % 8000;
+    m_last_timestamp.cycleOffset = ticks % 3072;
+    m_last_metadata.embeddedTimeStamp = (m_last_timestamp.cycleSeconds << 25) |
+                                        (m_last_timestamp.cycleCount << 12) |
+                                        m_last_timestamp.cycleOffset;
+    m_last_metadata.embeddedFrameCounter = m_frame_counter;
+
+    // Enabled embedded items overwrite the first pixels in
+    // order, big endian, like on the camera
+    unsigned char *data = pImage->GetData();
+    if (m_embedded_info.timestamp.onOff)
+    {
+        _putEmbedded(data, m_last_metadata.embeddedTimeStamp);
+        data += 4;
+    }
+    if (m_embedded_info.frameCounter.onOff)
+        _putEmbedded(data, m_frame_counter);
+}
@@ -57,7 +57,11 @@ SyncCtrlObj::SyncCtrlObj(Camera& cam)
 bool SyncCtrlObj::checkTrigMode(TrigMode trig_mode)
 {
     DEB_MEMBER_FUNCT();
-    return true;
+    DEB_PARAM() << DEB_VAR1(trig_mode);
+    bool valid;
+    m_cam.checkTrigMode(trig_mode, valid);
+    DEB_RETURN() << DEB_VAR1(valid);
+    return valid;
 }
 
 //-----------------------------------------------------